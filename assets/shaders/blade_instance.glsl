@@ -0,0 +1,81 @@
+// Rebuilds the transformation of a blade from its packed instance, see
+// BladeInstance: translated to position in x and z, rotated around the
+// y-axis by angles.x, then around the x-axis by angles.y, in half turns.
+mat4 bladeTransform(vec2 position, vec2 angles)
+{
+	const float PI = 3.14159265;
+	vec2 yaw = vec2(cos(angles.x * PI), sin(angles.x * PI));
+	vec2 tilt = vec2(cos(angles.y * PI), sin(angles.y * PI));
+
+	mat4 rotateX = mat4(
+		1.0, 0.0, 0.0, 0.0,
+		0.0, tilt.x, tilt.y, 0.0,
+		0.0, -tilt.y, tilt.x, 0.0,
+		0.0, 0.0, 0.0, 1.0);
+	mat4 rotateY = mat4(
+		yaw.x, 0.0, -yaw.y, 0.0,
+		0.0, 1.0, 0.0, 0.0,
+		yaw.y, 0.0, yaw.x, 0.0,
+		0.0, 0.0, 0.0, 1.0);
+	mat4 translation = mat4(1.0);
+	translation[3] = vec4(position.x, 0.0, position.y, 1.0);
+
+	return translation * rotateX * rotateY;
+}
+
+uint bladeHash(uint value)
+{
+	// PCG
+	uint state = value * 747796405u + 2891336453u;
+	uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+// Hash of where a patch is, different for every patch
+uint patchSeed(vec2 patchCorner)
+{
+	return bladeHash(floatBitsToUint(patchCorner.x) ^ bladeHash(floatBitsToUint(patchCorner.y)));
+}
+
+// A random number in [0, 1) that stays the same for blade bladeIndex of the
+// patch at patchCorner
+float bladeRandom(vec2 patchCorner, uint bladeIndex)
+{
+	return float(bladeHash(patchSeed(patchCorner) + bladeHash(bladeIndex + 0x9E3779B9u)) >> 8) / 16777216.0;
+}
+
+// Places blade bladeIndex of the patch at patchCorner without an instance
+// buffer, following BladeDistribution distribution the way Patch does.
+// Positions come from a low discrepancy sequence, so the first blades of a
+// patch always cover it evenly for the density LOD. The sequence is shifted
+// and the blades are rotated by a hash of the patch, so every patch is
+// different.
+void proceduralBlade(vec2 patchCorner, uint bladeIndex, int distribution, float patchSize,
+	out vec2 position, out vec2 angles)
+{
+	uint seed = patchSeed(patchCorner);
+	uvec2 offset = uvec2(bladeHash(seed), bladeHash(seed + 1u));
+	angles = vec2(0.0);
+
+	// Steps of the sequences as fractions of 2^32, so they wrap around
+	// exactly however many blades there are
+	if (distribution == 2) // ONE_DIRECTION
+	{
+		// Golden ratio, along the middle of the patch
+		uint z = offset.y + bladeIndex * 2654435769u;
+		position = vec2(0.5, float(z) / 4294967296.0) * patchSize;
+		return;
+	}
+
+	// R2, the two dimensional golden ratio
+	uvec2 xz = offset + bladeIndex * uvec2(3242174889u, 2447445414u);
+	position = vec2(xz) / 4294967296.0 * patchSize;
+
+	if (distribution == 0) // HARRY_STYLES_WITH_RANDOS
+	{
+		uint bladeSeed = bladeHash(seed ^ bladeHash(bladeIndex));
+		vec2 random = vec2(bladeHash(bladeSeed), bladeHash(bladeSeed + 1u)) / 4294967296.0;
+		// The same sway bounds as Patch, 180 degrees around y and 20 around x
+		angles = vec2(random.x * 2.0 - 1.0, (random.y * 2.0 - 1.0) * (20.0 / 180.0));
+	}
+}
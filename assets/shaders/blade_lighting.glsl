@@ -0,0 +1,24 @@
+// Lighting of the blades, shared by everything drawn as grass. Needs
+// scene_uniforms.glsl.
+vec4 shadeBlade(vec4 objectColor, vec3 normal, vec3 fragPos)
+{
+    vec3 ambient = vec3(ambientStrength, ambientStrength, ambientStrength);
+    
+
+	float constant = 1.0f;
+    float linear = 0.09f;
+    float quadratic = 0.032f;
+
+	float distance = length(lightPos - fragPos);
+	float attenuation = 1.0 / (constant + linear * distance + quadratic * (distance * distance));
+
+	vec3 norm = normalize(normal);
+	vec3 lightDir = normalize(lightPos - fragPos);  
+	
+	float diff = max(dot(norm, lightDir), 0.0);
+	vec3 diffuse = diff * lightColor.xyz;
+
+	diffuse *= attenuation * lightIntensity;
+	
+	return vec4(ambient, 1.0f) * objectColor + vec4(diffuse, 1.0f) * objectColor;
+}
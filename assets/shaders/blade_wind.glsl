@@ -0,0 +1,76 @@
+// How the wind sways the blades, shared by everything drawn as grass. Needs
+// scene_uniforms.glsl.
+
+// 0/1: Perlin/Checker: windX/windY are magnitude only.
+// 2/3:	Fluid Grid/Flipbook:	windX/windY are velocities.
+uniform sampler2D windX;
+uniform sampler2D windY;
+
+float map2(float x, float in_min, float in_max, float out_min, float out_max)
+{
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+vec2 sample_velocity(vec2 texture_pixel)
+{
+	float stepsize = 0.01f;
+	float base_x = texture_pixel.x - stepsize;
+	float base_y = texture_pixel.y - stepsize;
+	
+	int root_samples = 3;
+	float total_samples = root_samples * root_samples;
+
+	vec2 velocity = vec2(0, 0);
+	
+	for(int y = 0; y < root_samples; y++)
+	{
+		for(int x = 0; x < root_samples; x++)
+		{
+			vec2 sample_pos = vec2(base_x + x * stepsize, base_y + y * stepsize);
+			velocity.x += texture(windX, sample_pos).r;
+			velocity.y += texture(windY, sample_pos).r;
+		}
+	}
+	velocity /= total_samples;
+
+	return velocity;
+}
+
+// Offset the wind adds to a vertex at world_space_position. bend is how much
+// the wind affects the vertex, 0 at the root of a blade. wind is the noise or
+// the velocity that was sampled, for debugging.
+vec4 windContribution(vec4 world_space_position, float bend, out vec2 wind)
+{
+	// Map the world space position to the texture coordinate
+	// So that texture maps to all patches instead of one
+	vec2 actual_pos = world_space_position.xz;
+	actual_pos.x = map2(actual_pos.x, worldMin, worldMax, 0.0f, 1.0f);
+	actual_pos.y = map2(actual_pos.y, worldMax, worldMin, 0.0f, 1.0f); // y axis is flipped
+
+	wind = vec2(0.0f);
+	if(simulationMode == 0 || simulationMode == 1) // PERLIN_NOISE, CHECKER_PATTERN,
+	{
+		vec2 wind_direction = normalize(windDirection);
+		vec2 texture_pixel = actual_pos + windOffset;
+		vec2 noise;
+		noise.r = texture(windX, texture_pixel).r;
+		noise.g = texture(windY, texture_pixel).r;
+		noise = (noise - 0.5f) * 2.0f;
+		wind = noise;
+
+		vec2 swag = swayReach * noise * bend;
+		return vec4(wind_direction.x * swag.x, 0.0f, wind_direction.y * swag.y, 0.0f);
+	}
+	if(simulationMode == 2 || simulationMode == 3) // FLUID_GRID, FLUID_FLIPBOOK
+	{
+		vec2 velocity = sample_velocity(actual_pos);
+
+		velocity *= velocityMultiplier;
+		velocity = clamp(velocity, vec2(0, 0), velocityClampRange); 
+		wind = velocity;
+
+		vec2 swag = swayReach * velocity * bend;
+		return vec4(swag.x, 0, swag.y, 0);
+	}
+	return vec4(0.0f);
+}
@@ -6,40 +6,17 @@ in vec4 vtxColor;
 in vec3 Normal;
 in vec3 FragPos;
 
-uniform float ambientStrength; 
-uniform vec3 lightPos; 
-uniform float lightIntensity;
-uniform vec4 lightColor;
-uniform bool debugBlades;
+#include "scene_uniforms.glsl"
+#include "blade_lighting.glsl"
 
 
 void main()
 {
-    vec3 ambient = vec3(ambientStrength, ambientStrength, ambientStrength);
-    
-
-	float constant = 1.0f;
-    float linear = 0.09f;
-    float quadratic = 0.032f;
-
-	float distance = length(lightPos - FragPos);
-	float attenuation = 1.0 / (constant + linear * distance + quadratic * (distance * distance));
-
-	vec3 norm = normalize(Normal);
-	vec3 lightDir = normalize(lightPos - FragPos);  
-	
-	float diff = max(dot(norm, lightDir), 0.0);
-	vec3 diffuse = diff * lightColor.xyz;
-
-	diffuse *= attenuation * lightIntensity;
-	
 	vec4 objectColor = vtxColor;
 	
-	vec4 result = vec4(ambient, 1.0f) * objectColor + vec4(diffuse, 1.0f) * objectColor;
-	
-	FragColor = result; 
+	FragColor = shadeBlade(objectColor, Normal, FragPos); 
 
 	if (debugBlades)
 		FragColor = objectColor;
 		
-}
\ No newline at end of file
+}
@@ -0,0 +1,67 @@
+#version 430 core
+#include "draw_models.glsl"
+
+// The root of the blade, see bladeControlPointPositions
+layout (location = 0) in vec3 pos;
+layout (location = 1) in vec4 color;
+layout (location = 2) in vec3 normal;
+#ifndef PROCEDURAL_BLADES
+// Where the blade stands in its patch, or in the world once culled
+layout (location = 4) in vec2 bladePosition;
+// x: rotation around the y-axis, y: around the x-axis, in half turns
+// w: how much wider the blade is drawn
+layout (location = 5) in vec4 bladeShape;
+#endif
+
+// The curve blades.tese expands the blade along, in world space
+out Blade
+{
+	vec3 root;
+	vec3 middle;
+	vec3 tip;
+	// Half the width of the root
+	vec3 side;
+	vec4 color;
+	vec3 normal;
+} blade;
+
+#include "scene_uniforms.glsl"
+#include "blade_instance.glsl"
+#include "blade_wind.glsl"
+
+void main()
+{
+	mat4 model = drawModels[DRAW_INDEX];
+	// Same as in blades.vert
+	vec4 density = drawParameters[DRAW_INDEX];
+#ifdef PROCEDURAL_BLADES
+	vec2 bladeOffset;
+	vec2 bladeAngles;
+	proceduralBlade(model[3].xz, uint(gl_InstanceID), int(density.z) - 1, patchSize, bladeOffset, bladeAngles);
+	float bladeWidth = 1.0;
+#else
+	vec2 bladeAngles = bladeShape.xy;
+	vec2 bladeOffset = bladePosition;
+	float bladeWidth = bladeShape.w;
+#endif
+	mat4 instanceMatrix = bladeTransform(bladeOffset, bladeAngles);
+	mat4 upright = bladeTransform(bladeOffset, vec2(bladeAngles.x, 0.0));
+
+	// The tessellated blade is a triangle as tall and as wide as the blade
+	// mesh. Grows straight up, then bends over to the tilted tip that the wind
+	// moves. The tip moves with the square of the height, like the vertices
+	// of the mesh do.
+	vec4 root = model * instanceMatrix * vec4(pos, 1.0);
+	vec4 tip = model * instanceMatrix * vec4(pos + vec3(0.0, bladeMeshHeight, 0.0), 1.0);
+	vec2 wind;
+	tip += windContribution(tip, 1.0, wind);
+
+	blade.root = root.xyz;
+	blade.middle = (model * upright * vec4(pos + vec3(0.0, bladeMeshHeight, 0.0), 1.0)).xyz;
+	blade.tip = tip.xyz;
+	blade.side = (model * instanceMatrix * vec4(bladeMeshWidth * 0.5 * bladeWidth * density.y, 0.0, 0.0, 0.0)).xyz;
+	blade.color = color;
+	if (debugBlades)
+		blade.color = simulationMode <= 1 ? vec4(0, 0, wind.r, 1.0f) : vec4(wind.rg, 0, 1.0f);
+	blade.normal = mat3(transpose(inverse(model * instanceMatrix))) * normal;
+}
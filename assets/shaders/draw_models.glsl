@@ -0,0 +1,23 @@
+// Model matrix of every draw of a SceneObjectMultiDraw. Include before any
+// declarations, it may enable an extension.
+#ifdef MULTI_DRAW_ID
+#extension GL_ARB_shader_draw_parameters : require
+#define DRAW_INDEX gl_DrawIDARB
+#else
+// Set per draw when multi draw is not supported
+uniform int drawIndex;
+#define DRAW_INDEX drawIndex
+#endif
+
+// Binding DRAW_MODEL_BUFFER_BINDING
+layout (std430, binding = 0) readonly buffer DrawModels
+{
+	mat4 drawModels[];
+};
+
+// Binding DRAW_PARAMETER_BUFFER_BINDING, what the vec4 of a draw means is up
+// to the shader
+layout (std430, binding = 1) readonly buffer DrawParameters
+{
+	vec4 drawParameters[];
+};
@@ -0,0 +1,38 @@
+#version 430 core
+
+out vec4 FragColor;
+
+in vec4 vtxColor;
+in vec3 Normal;
+in vec3 FragPos;
+in vec2 cardUVs;
+
+#include "scene_uniforms.glsl"
+#include "blade_lighting.glsl"
+
+// Blades baked by ImpostorCards, alpha is how much of a texel they cover
+uniform sampler2D impostorTexture;
+// Texels covered less than this are left out
+uniform float alphaCutoff;
+
+void main()
+{
+	vec4 blades = texture(impostorTexture, cardUVs);
+
+	// The mip maps average the thin blades away, give them back the coverage
+	// they lose with every level
+	float level = textureQueryLod(impostorTexture, cardUVs).x;
+	float alpha = blades.a * (1.0 + level * 0.25);
+
+	// Sharp edges that alpha to coverage smooths out, if there is more than
+	// one sample
+	alpha = (alpha - alphaCutoff) / max(fwidth(alpha), 1e-4) + 0.5;
+	if (alpha <= 0.0)
+		discard;
+
+	vec4 objectColor = vtxColor * vec4(blades.rgb, 1.0);
+	FragColor = vec4(shadeBlade(objectColor, Normal, FragPos).rgb, clamp(alpha, 0.0, 1.0));
+
+	if (debugBlades)
+		FragColor = vec4(objectColor.rgb, clamp(alpha, 0.0, 1.0));
+}
@@ -0,0 +1,37 @@
+#version 430 core
+#include "draw_models.glsl"
+
+layout (location = 0) in vec3 pos;
+layout (location = 1) in vec4 color;
+layout (location = 2) in vec3 normal;
+layout (location = 3) in vec2 uvs;
+
+out vec4 vtxColor;
+out vec3 Normal;
+out vec3 FragPos;
+out vec2 cardUVs;
+
+#include "scene_uniforms.glsl"
+#include "blade_wind.glsl"
+
+void main()
+{
+	// Scales the unit cards of a patch to the patch size and blade height,
+	// see PatchField
+	mat4 model = drawModels[DRAW_INDEX];
+	vtxColor = color;
+	cardUVs = uvs;
+	vec4 world_space_position = model * vec4(pos, 1.0);
+
+	// The top of a card sways like the tips of the blades painted on it
+	vec2 wind;
+	vec4 wind_contribution = windContribution(world_space_position, pow(uvs.y, 2), wind);
+	gl_Position = projection * view * (world_space_position + wind_contribution);
+
+	if (debugBlades)
+		vtxColor = simulationMode <= 1 ? vec4(0, 0, wind.r, 1.0f) : vec4(wind.rg, 0, 1.0f);
+
+	// Every card faces the way the blades do, so they are lit the same
+	Normal = mat3(transpose(inverse(model))) * normal;  
+	FragPos = world_space_position.xyz;
+}
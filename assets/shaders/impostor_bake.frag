@@ -0,0 +1,11 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in vec4 vtxColor;
+
+void main()
+{
+	// Lit when the cards are drawn
+	FragColor = vec4(vtxColor.rgb, 1.0);
+}
@@ -0,0 +1,25 @@
+#version 430 core
+
+layout (location = 0) in vec3 pos;
+layout (location = 1) in vec4 color;
+// The BladeInstance of a blade of the template patch
+layout (location = 4) in vec2 bladePosition;
+layout (location = 5) in vec4 bladeShape;
+
+out vec4 vtxColor;
+
+#include "blade_instance.glsl"
+
+uniform float patchSize;
+// Height of the blade mesh, the top of the cards
+uniform float bladeTop;
+
+void main()
+{
+	vtxColor = color;
+	vec4 position = bladeTransform(bladePosition, bladeShape.xy) * vec4(pos.x * bladeShape.w, pos.yz, 1.0);
+
+	// Seen from the front, the width of the patch and the height of the blades
+	// fill the texture
+	gl_Position = vec4(position.x / patchSize * 2.0 - 1.0, position.y / bladeTop * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -1,9 +1,10 @@
 #version 330 core
 out vec4 FragColor;
 
-uniform vec4 lightColor;
+// The light and the fan icons are drawn in a single colour
+uniform vec4 objectColor;
 
 void main()
 {
-   FragColor = lightColor;
+   FragColor = objectColor;
 }
\ No newline at end of file
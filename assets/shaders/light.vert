@@ -2,8 +2,7 @@
 layout (location = 0) in vec3 vertex;
 
 
-uniform mat4 projection;
-uniform mat4 view;
+#include "scene_uniforms.glsl"
 uniform mat4 model;
 
 void main()
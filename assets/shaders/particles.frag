@@ -0,0 +1,36 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in vec4 vtxColor;
+in vec3 Normal;
+in vec3 FragPos;
+in vec2 UV;
+
+#include "scene_uniforms.glsl"
+
+
+void main()
+{
+	// Round particles
+	vec2 from_center = UV - vec2(0.5f, 0.5f);
+	if (dot(from_center, from_center) > 0.25f)
+		discard;
+
+	vec3 ambient = vec3(ambientStrength, ambientStrength, ambientStrength);
+
+	float constant = 1.0f;
+	float linear = 0.09f;
+	float quadratic = 0.032f;
+
+	float distance = length(lightPos - FragPos);
+	float attenuation = 1.0 / (constant + linear * distance + quadratic * (distance * distance));
+
+	// Lit from both sides, particles are thin
+	vec3 norm = normalize(Normal);
+	vec3 lightDir = normalize(lightPos - FragPos);
+	float diff = abs(dot(norm, lightDir));
+	vec3 diffuse = diff * lightColor.xyz * attenuation * lightIntensity;
+
+	FragColor = vec4(ambient, 1.0f) * vtxColor + vec4(diffuse, 1.0f) * vtxColor;
+}
@@ -0,0 +1,36 @@
+#version 420 core
+layout (location = 0) in vec3 pos;
+layout (location = 1) in vec4 color;
+layout (location = 2) in vec3 normal;
+layout (location = 3) in vec2 uvs;
+// instanceMatrix also uses locations 5, 6 & 7
+layout (location = 4) in mat4 instanceMatrix;
+
+out vec4 vtxColor;
+out vec3 Normal;
+out vec3 FragPos;
+out vec2 UV;
+
+#include "scene_uniforms.glsl"
+uniform mat4 model;
+
+uniform vec4 particleColor;
+
+void main()
+{
+	vtxColor = color * particleColor;
+	UV = uvs;
+
+	// The instance matrix only holds the position and size of the particle,
+	// the quad itself always faces the camera
+	vec4 world_space_center = model * instanceMatrix * vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	float size = length(instanceMatrix[0].xyz);
+
+	vec4 view_space_position = view * world_space_center;
+	view_space_position.xy += pos.xy * size;
+	gl_Position = projection * view_space_position;
+
+	// The quad faces the camera, so its normal points back at the camera
+	Normal = transpose(mat3(view)) * normal;
+	FragPos = world_space_center.xyz;
+}
@@ -6,16 +6,7 @@ in vec4 VtxColor;
 in vec3 Normal;
 in vec3 FragPos;
 
-uniform float ambientStrength; 
-uniform vec3 lightPos; 
-uniform float lightIntensity;
-uniform vec4 lightColor;
-uniform float windStrength;
-uniform float currentTime;
-uniform bool visualizeTexture;
-uniform vec2 windDirection;
-uniform float worldMin;
-uniform float worldMax;
+#include "scene_uniforms.glsl"
 
 uniform sampler2D windX;
 uniform sampler2D windY;
@@ -50,7 +41,7 @@ void main()
     actual_pos.x = map2(actual_pos.x, worldMin, worldMax, 0.0f, 1.0f);
     actual_pos.y = map2(actual_pos.y, worldMax, worldMin, 0.0f, 1.0f); // y axis is flipped
 				
-	vec2 texture_pixel = actual_pos + (currentTime * windStrength * windDirection);
+	vec2 texture_pixel = actual_pos + windOffset;
 	vec4 patchColor;
 	if (visualizeTexture) {	
 		patchColor.r = abs(texture(windX, texture_pixel).r);
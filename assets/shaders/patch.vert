@@ -1,4 +1,6 @@
-#version 330 core
+#version 430 core
+#include "draw_models.glsl"
+
 layout (location = 0) in vec3 pos;
 layout (location = 1) in vec4 color;
 layout (location = 2) in vec3 normal;
@@ -7,12 +9,11 @@ out vec3 FragPos;
 out vec3 Normal;
 out vec4 VtxColor;
 
-uniform mat4 projection;
-uniform mat4 view;
-uniform mat4 model;
+#include "scene_uniforms.glsl"
 
 void main()
 {
+   mat4 model = drawModels[DRAW_INDEX];
    gl_Position = projection * view * model * vec4(pos, 1.0);
    Normal = mat3(transpose(inverse(model))) * normal;  
    FragPos = vec3(model * vec4(pos, 1.0));
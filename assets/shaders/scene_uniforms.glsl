@@ -0,0 +1,34 @@
+// Scene wide state, written once per frame by SceneUniformBuffer. The layout
+// has to match SceneUniformData.
+layout (std140) uniform SceneUniforms
+{
+	mat4 projection;
+	mat4 view;
+	vec4 lightColor;
+	vec3 lightPos;
+	float ambientStrength;
+	vec2 windDirection;
+	// How far the wind has moved the perlin noise and checker pattern, in
+	// texture coordinates
+	vec2 windOffset;
+	vec2 velocityClampRange;
+	float lightIntensity;
+	float currentTime;
+	float windStrength;
+	float swayReach;
+	float velocityMultiplier;
+	float worldMin;
+	float worldMax;
+	float patchSize;
+	// 0/1: Perlin/Checker, 2/3: Fluid Grid/Flipbook
+	int simulationMode;
+	bool debugBlades;
+	bool visualizeTexture;
+	// Segments of the tessellated blades up close, and the distance up to
+	// which they get all of them, see blades.tesc
+	int bladeTessellationLevel;
+	float bladeTessellationDistance;
+	// Height and widest width of the blade mesh, see grassPositions
+	float bladeMeshHeight;
+	float bladeMeshWidth;
+};
@@ -3,8 +3,7 @@ layout (location = 0) in vec3 vertex;
 
 out vec3 TexCoords;
 
-uniform mat4 projection;
-uniform mat4 view;
+#include "scene_uniforms.glsl"
 
 void main()
 {
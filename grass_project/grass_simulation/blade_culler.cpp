@@ -0,0 +1,309 @@
+#include "blade_culler.h"
+#include "scene.h"
+#include "grass_math.h"
+#include "logger.h"
+#include <rendering/scene_object_multi_draw.h>
+#include <rendering/primitives.h>
+#include <rendering/texture.h>
+#include <rendering/gl_state.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+
+namespace
+{
+	/**
+	 * \brief Invocations per work group of blade_culling.comp
+	 */
+	const int CULLING_GROUP_SIZE = 256;
+
+	/**
+	 * \brief A blade that survived culling, as blade_culling.comp writes it
+	 */
+	struct VisibleBladeInstance
+	{
+		// World x and z
+		float position[2];
+		// Half floats: the angles of BladeInstance, an unused half and the
+		// width
+		glm::uint32 angles;
+		glm::uint32 width;
+	};
+
+	const InstanceLayout VISIBLE_BLADE_INSTANCE_LAYOUT = {
+		{
+			{ "bladePosition", 2, GL_FLOAT, GL_FALSE, offsetof(VisibleBladeInstance, position) },
+			{ "bladeShape", 4, GL_HALF_FLOAT, GL_FALSE, offsetof(VisibleBladeInstance, angles) },
+		},
+		sizeof(VisibleBladeInstance)
+	};
+}
+
+float maxBladeSway(const Config& config)
+{
+	// The noise modes sway at most swayReach, the fluid modes swayReach times
+	// the clamped velocity
+	const glm::vec2& clampRange = config.fluidGridConfig.velocityClampRange;
+	return config.swayReach * glm::max(1.0f, glm::max(clampRange.x, clampRange.y));
+}
+
+BladeCuller::BladeCuller(SceneObjectMultiDraw& blades, unsigned int bladeInstanceBuffer,
+	ShaderProgram& bladesShaderProgram)
+	: bladeInstanceBuffer(bladeInstanceBuffer)
+{
+	computeShader = new Shader("assets/shaders/blade_culling.comp", GL_COMPUTE_SHADER);
+	computeShaderProgram = new ShaderProgram({ computeShader }, "BLADE CULLING COMPUTE SHADER");
+
+	// The blades are tested in a 2D grid of groups, and written to one
+	// storage block
+	GLint maxGroupsX = 65535;
+	GLint maxGroupsY = 65535;
+	GLint64 maxBlockSize = 1 << 27;
+	GLCall(glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 0, &maxGroupsX));
+	GLCall(glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 1, &maxGroupsY));
+	GLCall(glGetInteger64v(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &maxBlockSize));
+	maxCullingGroupsX = maxGroupsX;
+	int64_t maxBlades = std::min((int64_t)maxGroupsX * maxGroupsY * CULLING_GROUP_SIZE,
+		(int64_t)maxBlockSize / (int64_t)sizeof(VisibleBladeInstance));
+	maxTestedBlades = (int)std::min(maxBlades, (int64_t)INT_MAX);
+
+	// Grown on demand by cull
+	visibleBladeCapacity = 1;
+	GLCall(glGenBuffers(1, &visibleBladeBuffer));
+	GLState::bindBuffer(GL_ARRAY_BUFFER, visibleBladeBuffer);
+	GLCall(glBufferData(GL_ARRAY_BUFFER, visibleBladeCapacity * sizeof(VisibleBladeInstance), nullptr, GL_DYNAMIC_COPY));
+	GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+
+	DrawElementsIndirectCommand command = { blades.getIndexCount(), 0, 0, 0, 0 };
+	GLCall(glGenBuffers(1, &commandBuffer));
+	GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	GLCall(glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(command), &command, GL_DYNAMIC_COPY));
+	GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	GLCall(glGenBuffers(1, &countReadbackBuffer));
+	GLState::bindBuffer(GL_COPY_WRITE_BUFFER, countReadbackBuffer);
+	GLCall(glBufferData(GL_COPY_WRITE_BUFFER, sizeof(GLuint), nullptr, GL_STREAM_READ));
+	GLState::bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	// The visible blades already stand where their patch put them, and carry
+	// their own width. Their model is set by cull.
+	visibleBladesObject = new SceneObjectMultiDraw(grassPositions, grassColors, grassIndices, grassNormals,
+		bladesShaderProgram, &grassUVs, visibleBladeBuffer, &VISIBLE_BLADE_INSTANCE_LAYOUT);
+	visibleBladesObject->setDrawParameters({ glm::vec4(0.0f, 1.0f, 0.0f, 0.0f) });
+	visibleBladesObject->commandBuffer = commandBuffer;
+
+	// Bounding sphere of the blade mesh, around its middle
+	float minY = grassPositions[1];
+	float maxY = grassPositions[1];
+	for (size_t i = 1; i < grassPositions.size(); i += 3)
+	{
+		minY = std::min(minY, grassPositions[i]);
+		maxY = std::max(maxY, grassPositions[i]);
+	}
+	bladeCenterY = (minY + maxY) * 0.5f;
+	bladeHalfHeight = (maxY - minY) * 0.5f;
+}
+
+BladeCuller::~BladeCuller()
+{
+	if (cullFence)
+		GLCall(glDeleteSync(cullFence));
+	delete visibleBladesObject;
+	delete visibleTessellatedBladesObject;
+	GLState::deleteBuffer(visibleBladeBuffer);
+	GLState::deleteBuffer(commandBuffer);
+	GLState::deleteBuffer(tessellatedCommandBuffer);
+	GLState::deleteBuffer(countReadbackBuffer);
+	delete computeShaderProgram;
+	delete computeShader;
+}
+
+void BladeCuller::cull(Scene& scene, SceneObjectMultiDraw& source)
+{
+	readVisibleBlades();
+
+	const Config& config = scene.config;
+	culledTessellated = visibleTessellatedBladesObject && source.primitiveMode == GL_PATCHES;
+
+	// Only the patches the PatchField found visible are uploaded
+	int patches = source.getMaxDraws();
+	int bladesPerPatch = std::max(config.numBladesPerPatch, 0);
+	if (bladesPerPatch > 0 && patches > maxTestedBlades / bladesPerPatch)
+	{
+		// Only reached with view culling off and far more patches than the
+		// GPU can hold the blades of
+		if (!warnedBladeLimit)
+		{
+			LOG_WARNING("The blade pass can test %d blades, only the first %d of %d patches get blades",
+				maxTestedBlades, maxTestedBlades / bladesPerPatch, patches);
+			warnedBladeLimit = true;
+		}
+		patches = maxTestedBlades / bladesPerPatch;
+	}
+	testedBlades = patches * bladesPerPatch;
+
+	if (testedBlades > visibleBladeCapacity)
+	{
+		// Keeps the buffer name, so the vertex array still points at it
+		visibleBladeCapacity = testedBlades;
+		GLState::bindBuffer(GL_ARRAY_BUFFER, visibleBladeBuffer);
+		GLCall(glBufferData(GL_ARRAY_BUFFER, visibleBladeCapacity * sizeof(VisibleBladeInstance), nullptr, GL_DYNAMIC_COPY));
+		GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	// The culling pass counts the visible blades up from zero
+	GLuint zero = 0;
+	GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	GLCall(glBufferSubData(GL_DRAW_INDIRECT_BUFFER, offsetof(DrawElementsIndirectCommand, instanceCount), sizeof(zero), &zero));
+	GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	if (culledTessellated)
+	{
+		GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, tessellatedCommandBuffer);
+		GLCall(glBufferSubData(GL_DRAW_INDIRECT_BUFFER, offsetof(DrawElementsIndirectCommand, instanceCount), sizeof(zero), &zero));
+		GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+
+	if (testedBlades == 0)
+		return;
+
+	// Only the height of the patch models is left to apply, see PatchField
+	if (config.bladeHeight != drawnBladeHeight)
+	{
+		glm::mat4 model = glm::scale(1, config.bladeHeight, 1);
+		visibleBladesObject->setDrawModels({ model });
+		if (visibleTessellatedBladesObject)
+			visibleTessellatedBladesObject->setDrawModels({ model });
+		drawnBladeHeight = config.bladeHeight;
+	}
+
+	Frustum frustum(scene.projection * scene.view);
+	glm::vec3 cameraPosition = glm::vec3(glm::inverse(scene.view)[3]);
+
+	// The blades are scaled by their height, and the wind moves their tips
+	float bladeRadius = bladeHalfHeight * config.bladeHeight + maxBladeSway(config);
+
+	computeShaderProgram->use();
+	computeShaderProgram->setInt("numPatches", patches);
+	computeShaderProgram->setInt("bladesPerPatch", bladesPerPatch);
+	computeShaderProgram->setFloat("patchSize", config.patchSize);
+	GLCall(glUniform4fv(computeShaderProgram->getUniformLocation("frustumPlanes"), 6, &frustum.planes[0].x));
+	computeShaderProgram->setVec3("cameraPosition", cameraPosition);
+	computeShaderProgram->setFloat("maxDistance", config.cullingConfig.maxDistance);
+	computeShaderProgram->setVec3("bladeCenter", 0.0f, bladeCenterY, 0.0f);
+	computeShaderProgram->setFloat("bladeRadius", bladeRadius);
+	computeShaderProgram->setBool("cullToView", config.cullingConfig.enabled);
+
+	const DensityMapConfig& densityMapConfig = config.densityMapConfig;
+	bool useDensityMap = densityMapConfig.enabled && densityMapConfig.texture != nullptr;
+	computeShaderProgram->setBool("useDensityMap", useDensityMap);
+	if (useDensityMap)
+	{
+		densityMapConfig.texture->activate();
+		densityMapConfig.texture->bind();
+		computeShaderProgram->setInt("densityMap", (int)densityMapConfig.texture->getTextureID());
+		computeShaderProgram->setVec2("densityRange", densityMapConfig.range);
+		computeShaderProgram->setFloat("worldMin", config.worldMin);
+		computeShaderProgram->setFloat("worldMax", config.worldMax);
+	}
+
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, source.getDrawModelBuffer());
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, bladeInstanceBuffer);
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, visibleBladeBuffer);
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, commandBuffer);
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, source.getDrawParameterBuffer());
+
+	// Rows of groups, as one row may not have enough of them for every blade
+	int groups = (testedBlades + CULLING_GROUP_SIZE - 1) / CULLING_GROUP_SIZE;
+	int groupsX = std::min(groups, maxCullingGroupsX);
+	GLCall(glDispatchCompute(groupsX, (groups + groupsX - 1) / groupsX, 1));
+
+	// The draw reads the command and the instances the pass wrote, and the
+	// count is copied out below and zeroed by the next cull with buffer updates
+	GLCall(glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT));
+
+	// The control points are drawn with a command of one index, with as many
+	// instances
+	if (culledTessellated)
+	{
+		GLState::bindBuffer(GL_COPY_READ_BUFFER, commandBuffer);
+		GLState::bindBuffer(GL_COPY_WRITE_BUFFER, tessellatedCommandBuffer);
+		GLCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+			offsetof(DrawElementsIndirectCommand, instanceCount),
+			offsetof(DrawElementsIndirectCommand, instanceCount), sizeof(GLuint)));
+		GLState::bindBuffer(GL_COPY_READ_BUFFER, 0);
+		GLState::bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	// Keep a copy of the count for the statistics, read once the GPU is done
+	if (!cullFence)
+	{
+		GLState::bindBuffer(GL_COPY_READ_BUFFER, commandBuffer);
+		GLState::bindBuffer(GL_COPY_WRITE_BUFFER, countReadbackBuffer);
+		GLCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+			offsetof(DrawElementsIndirectCommand, instanceCount), 0, sizeof(GLuint)));
+		GLState::bindBuffer(GL_COPY_READ_BUFFER, 0);
+		GLState::bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		cullFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+}
+
+void BladeCuller::draw(Scene& scene)
+{
+	if (culledTessellated)
+		visibleTessellatedBladesObject->draw(scene);
+	else
+		visibleBladesObject->draw(scene);
+}
+
+void BladeCuller::setTessellatedBlades(SceneObjectMultiDraw& tessellatedBlades, ShaderProgram& tessellatedShaderProgram)
+{
+	DrawElementsIndirectCommand command = { tessellatedBlades.getIndexCount(), 0, 0, 0, 0 };
+	GLCall(glGenBuffers(1, &tessellatedCommandBuffer));
+	GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, tessellatedCommandBuffer);
+	GLCall(glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(command), &command, GL_DYNAMIC_COPY));
+	GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	visibleTessellatedBladesObject = new SceneObjectMultiDraw(bladeControlPointPositions, bladeControlPointColors,
+		bladeControlPointIndices, bladeControlPointNormals, tessellatedShaderProgram, nullptr, visibleBladeBuffer,
+		&VISIBLE_BLADE_INSTANCE_LAYOUT);
+	visibleTessellatedBladesObject->setDrawParameters({ glm::vec4(0.0f, 1.0f, 0.0f, 0.0f) });
+	visibleTessellatedBladesObject->commandBuffer = tessellatedCommandBuffer;
+	visibleTessellatedBladesObject->primitiveMode = GL_PATCHES;
+	// Set by the next cull
+	drawnBladeHeight = -1.0f;
+}
+
+void BladeCuller::reloadShaders()
+{
+	computeShaderProgram->reloadShaders();
+}
+
+int BladeCuller::getVisibleBlades() const
+{
+	return visibleBlades;
+}
+
+int BladeCuller::getTestedBlades() const
+{
+	return testedBlades;
+}
+
+void BladeCuller::readVisibleBlades()
+{
+	if (!cullFence)
+		return;
+
+	GLenum status = glClientWaitSync(cullFence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+		return;
+
+	GLCall(glDeleteSync(cullFence));
+	cullFence = nullptr;
+
+	GLuint count = 0;
+	GLState::bindBuffer(GL_COPY_READ_BUFFER, countReadbackBuffer);
+	GLCall(glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(count), &count));
+	GLState::bindBuffer(GL_COPY_READ_BUFFER, 0);
+	visibleBlades = (int)count;
+}
@@ -0,0 +1,169 @@
+#ifndef BLADE_CULLER_H
+#define BLADE_CULLER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+
+struct Config;
+class Scene;
+class SceneObjectMultiDraw;
+class Shader;
+class ShaderProgram;
+class Texture;
+
+/**
+ * \brief Settings of the blade culling.
+ * maxDistance:	Blades further from the camera than this are not drawn.
+ */
+struct CullingConfig
+{
+	bool  enabled = true;
+	float maxDistance = 150.0f;
+};
+
+/**
+ * \brief Settings of the density map that decides where blades grow.
+ * The blade pass of BladeCuller keeps a blade where a hash of the blade is
+ * below the density under it, the red channel of texture. The map covers the
+ * world like the wind textures do.
+ * range:	Map values that grow no blades and all the blades.
+ * seed:	Seed of the generated map.
+ */
+struct DensityMapConfig
+{
+	bool      enabled = false;
+	glm::vec2 range = { 0.35f, 0.65f };
+	uint32_t  seed = 3;
+	Texture*  texture = nullptr;
+};
+
+/**
+ * \brief How far the wind can move the tip of a blade sideways, so culling
+ * does not drop blades that sway into view.
+ */
+float maxBladeSway(const Config& config);
+
+/**
+ * \brief Places and culls the blades on the GPU before they are drawn.
+ * A compute pass places every blade of every drawn patch, drops the ones
+ * the density map leaves out, and tests the rest against the view frustum
+ * and the cull distance. The survivors are packed into an instance
+ * buffer, 16 bytes each with their patch already applied, and their count
+ * is written straight into the indirect command they are drawn with, so
+ * the CPU never waits for the result.
+ */
+class BladeCuller
+{
+public:
+	/**
+	 * \param blades The mesh the visible blades are drawn with.
+	 * \param bladeInstanceBuffer Placement of every blade within a patch, the
+	 * BladeInstance of blades.
+	 * \param bladesShaderProgram Draws the visible blades.
+	 */
+	BladeCuller(SceneObjectMultiDraw& blades, unsigned int bladeInstanceBuffer,
+		ShaderProgram& bladesShaderProgram);
+	~BladeCuller();
+
+	BladeCuller(const BladeCuller&) = delete;
+	BladeCuller& operator=(const BladeCuller&) = delete;
+
+	/**
+	 * \brief Culls the blades of source for the camera of scene. Only applies
+	 * the density map if culling is disabled.
+	 * \param source The blades PatchField handed the visible patches to, one
+	 * draw per patch, see SceneObjectMultiDraw.
+	 */
+	void cull(Scene& scene, SceneObjectMultiDraw& source);
+
+	/**
+	 * \brief Draws the blades that survived the last cull.
+	 */
+	void draw(Scene& scene);
+
+	/**
+	 * \brief Draws the visible blades with tessellatedShaderProgram, one
+	 * control point each, when the culled source draws patches.
+	 * \param tessellatedBlades The control point the visible blades are
+	 * drawn with.
+	 */
+	void setTessellatedBlades(SceneObjectMultiDraw& tessellatedBlades, ShaderProgram& tessellatedShaderProgram);
+
+	void reloadShaders();
+
+	/**
+	 * \brief Blades that survived a recent cull. Read back without waiting,
+	 * so it lags a frame or two behind.
+	 */
+	int getVisibleBlades() const;
+
+	/**
+	 * \brief Blades that were tested by the last cull.
+	 */
+	int getTestedBlades() const;
+
+private:
+	/**
+	 * \brief Reads back the visible count of the last cull if the GPU is done
+	 */
+	void readVisibleBlades();
+
+	unsigned int bladeInstanceBuffer = 0;
+
+	Shader* computeShader = nullptr;
+	ShaderProgram* computeShaderProgram = nullptr;
+
+	/**
+	 * \brief Draws the visible blade buffer with the command buffer
+	 */
+	SceneObjectMultiDraw* visibleBladesObject = nullptr;
+
+	GLuint visibleBladeBuffer = 0;
+	GLuint commandBuffer = 0;
+	int visibleBladeCapacity = 0;
+
+	/**
+	 * \brief The visible blades as control points, with a command of their
+	 * own that the count is copied into
+	 */
+	SceneObjectMultiDraw* visibleTessellatedBladesObject = nullptr;
+	GLuint tessellatedCommandBuffer = 0;
+
+	/**
+	 * \brief The last cull was of the tessellated blades
+	 */
+	bool culledTessellated = false;
+
+	/**
+	 * \brief Blade height the visible blades are drawn with
+	 */
+	float drawnBladeHeight = -1.0f;
+
+	/**
+	 * \brief Copy of the visible count, so reading it never waits for a later
+	 * cull
+	 */
+	GLuint countReadbackBuffer = 0;
+
+	/**
+	 * \brief Bounding sphere of the blade mesh, before it is scaled by the
+	 * blade height
+	 */
+	float bladeCenterY = 0.0f;
+	float bladeHalfHeight = 0.0f;
+
+	/**
+	 * \brief Most blades one cull can test, limited by the work groups of a
+	 * dispatch and the size of the visible blade buffer the pass can address
+	 */
+	int maxTestedBlades = 0;
+	int maxCullingGroupsX = 0;
+	bool warnedBladeLimit = false;
+
+	GLsync cullFence = nullptr;
+	int visibleBlades = 0;
+	int testedBlades = 0;
+};
+
+#endif
@@ -5,12 +5,77 @@
 #define SWAP(x0,x) {float *tmp=x0;x0=x;x=tmp;}
 
 #include "fluid_grid.h"
+#include "wind_field_publisher.h"
+#include "logger.h"
 #include <stdlib.h>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#define NOGDI
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FLUID_GRID_USE_SSE2
+#include <emmintrin.h>
+#endif
 
 #define IX(i,j) ((i)+(N+2)*(j))
 #define FOR_EACH_CELL for ( i=1 ; i<=N ; i++ ) { for ( j=1 ; j<=N ; j++ ) {
 #define END_FOR }}
 
+namespace
+{
+	/**
+	 * \brief Number of fields in the arena: density, densityPrev, velX, velY,
+	 * velXPrev and velYPrev, in that order.
+	 */
+	const int FLUID_GRID_FIELDS = 6;
+
+	const char FLUID_GRID_SNAPSHOT_MAGIC[4] = { 'F', 'G', 'S', 'S' };
+	const uint32_t FLUID_GRID_SNAPSHOT_VERSION = 1;
+
+	/**
+	 * \brief Start of a snapshot file. The fields start at fieldsOffset, in
+	 * arena order, and are followed by fanCount FluidGridSnapshotFans.
+	 */
+	struct FluidGridSnapshotHeader
+	{
+		char     magic[4];
+		uint32_t version;
+		uint32_t N;
+		float    diffusion;
+		float    viscosity;
+		uint32_t fanCount;
+		uint32_t fieldsOffset;
+		uint32_t fansOffset;
+	};
+
+	struct FluidGridSnapshotFan
+	{
+		uint32_t active;
+		float    positionX;
+		float    positionY;
+		float    velocityX;
+		float    velocityY;
+		float    density;
+	};
+
+	/**
+	 * \brief The fields start on a cache line, keeping the arena aligned.
+	 */
+	const uint32_t FLUID_GRID_SNAPSHOT_FIELDS_OFFSET = 64;
+
+	/**
+	 * \brief Largest resolution a snapshot may have, far above what the
+	 * simulation runs at. Anything larger is taken for a corrupt header.
+	 */
+	const uint32_t FLUID_GRID_SNAPSHOT_MAX_N = 4096;
+	static_assert(sizeof(FluidGridSnapshotHeader) <= FLUID_GRID_SNAPSHOT_FIELDS_OFFSET, "Snapshot header overlaps the fields");
+}
+
 namespace JS
 {
 void add_source(int N, float *x, float *s, float dt)
@@ -138,37 +203,67 @@ FluidGrid::FluidGrid(int N, float diffusion, float viscosity, FluidGridConfig *f
 
 	diff     = diffusion;
 	visc     = viscosity;
+	config   = fluidGridConfig;
 
-	density     = new float[size]();
-	densityPrev = new float[size]();
-
-	velX = new float[size]();
-	velY = new float[size]();
+	arena = new float[FLUID_GRID_FIELDS * size]();
+	assignFields(arena);
 
-	velXPrev = new float[size]();
-	velYPrev = new float[size]();
-
-	textureDen  = new Texture("Den", GL_TEXTURE_2D);
-	textureVelX = new Texture("VelX", GL_TEXTURE_2D);
-	textureVelY = new Texture("VelY", GL_TEXTURE_2D);
+	if (fluidGridConfig)
+	{
+		textureDen  = new Texture("Den", GL_TEXTURE_2D);
+		textureVelX = new Texture("VelX", GL_TEXTURE_2D);
+		textureVelY = new Texture("VelY", GL_TEXTURE_2D);
 
-	fluidGridConfig->density = textureDen;
-	fluidGridConfig->velX    = textureVelX;
-	fluidGridConfig->velY    = textureVelY;
+		fluidGridConfig->density = textureDen;
+		fluidGridConfig->velX    = textureVelX;
+		fluidGridConfig->velY    = textureVelY;
+	}
 
 	initialize();
 }
 
 FluidGrid::~FluidGrid()
 {
-	free(density);
-	free(densityPrev);
+	releaseArena();
+}
+
+void FluidGrid::assignFields(float *arena)
+{
+	density     = arena;
+	densityPrev = arena + size;
 
-	free(velX);
-	free(velY);
+	velX = arena + 2 * size;
+	velY = arena + 3 * size;
 
-	free(velXPrev);
-	free(velYPrev);
+	velXPrev = arena + 4 * size;
+	velYPrev = arena + 5 * size;
+}
+
+void FluidGrid::ownArena()
+{
+	float *owned = new float[FLUID_GRID_FIELDS * size];
+	const float *fields[FLUID_GRID_FIELDS] = { density, densityPrev, velX, velY, velXPrev, velYPrev };
+	for (int i = 0; i < FLUID_GRID_FIELDS; i++)
+	{
+		memcpy(owned + i * size, fields[i], sizeof(float) * size);
+	}
+
+	releaseArena();
+	arena     = owned;
+	ownsArena = true;
+	assignFields(arena);
+}
+
+void FluidGrid::releaseArena()
+{
+	if (ownsArena)
+	{
+		delete[] arena;
+	}
+	delete snapshotMapping;
+
+	arena           = nullptr;
+	snapshotMapping = nullptr;
 }
 
 
@@ -370,6 +465,99 @@ void FluidGrid::setBounds(int b, float *x)
 #endif
 }
 
+void FluidGrid::sampleVelocities(const float *worldX, const float *worldZ, size_t count, float worldMin, float worldMax,
+	float *velocityX, float *velocityY) const
+{
+	// Texture coordinates, as in Scene::mapPositionFromWorldSpace, scaled to
+	// cells so that cell centers land on whole numbers.
+	const int   resolution = N + 2;
+	const float scale      = resolution / (worldMax - worldMin);
+	const float maxCell    = (float)(resolution - 1);
+	const float maxBase    = (float)(resolution - 2);
+
+	size_t i = 0;
+
+#ifdef FLUID_GRID_USE_SSE2
+	const __m128 minV        = _mm_set1_ps(worldMin);
+	const __m128 maxV        = _mm_set1_ps(worldMax);
+	const __m128 scaleV      = _mm_set1_ps(scale);
+	const __m128 halfV       = _mm_set1_ps(0.5f);
+	const __m128 zeroV       = _mm_setzero_ps();
+	const __m128 maxCellV    = _mm_set1_ps(maxCell);
+	const __m128 maxBaseV    = _mm_set1_ps(maxBase);
+	const __m128 resolutionV = _mm_set1_ps((float)resolution);
+
+	alignas(16) int   indices[4];
+	alignas(16) float corners[4][4];
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(worldX + i);
+		__m128 z = _mm_loadu_ps(worldZ + i);
+
+		// The z axis is flipped
+		__m128 cellX = _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(x, minV), scaleV), halfV);
+		__m128 cellY = _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(maxV, z), scaleV), halfV);
+		cellX        = _mm_min_ps(_mm_max_ps(cellX, zeroV), maxCellV);
+		cellY        = _mm_min_ps(_mm_max_ps(cellY, zeroV), maxCellV);
+
+		// Non-negative, so truncating is flooring. The base cell stays one
+		// away from the edge, so its neighbours are inside the grid.
+		__m128 baseX = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(cellX)), maxBaseV);
+		__m128 baseY = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(cellY)), maxBaseV);
+		__m128 tx    = _mm_sub_ps(cellX, baseX);
+		__m128 ty    = _mm_sub_ps(cellY, baseY);
+
+		// Exact in float for any grid that fits in memory
+		_mm_store_si128((__m128i *)indices, _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(baseY, resolutionV), baseX)));
+
+		for (int field = 0; field < 2; field++)
+		{
+			const float *values = field == 0 ? velX : velY;
+			for (int lane = 0; lane < 4; lane++)
+			{
+				const float *cell = values + indices[lane];
+				corners[0][lane] = cell[0];
+				corners[1][lane] = cell[1];
+				corners[2][lane] = cell[resolution];
+				corners[3][lane] = cell[resolution + 1];
+			}
+
+			__m128 c00    = _mm_load_ps(corners[0]);
+			__m128 c10    = _mm_load_ps(corners[1]);
+			__m128 c01    = _mm_load_ps(corners[2]);
+			__m128 c11    = _mm_load_ps(corners[3]);
+			__m128 top    = _mm_add_ps(c00, _mm_mul_ps(tx, _mm_sub_ps(c10, c00)));
+			__m128 bottom = _mm_add_ps(c01, _mm_mul_ps(tx, _mm_sub_ps(c11, c01)));
+			__m128 result = _mm_add_ps(top, _mm_mul_ps(ty, _mm_sub_ps(bottom, top)));
+
+			_mm_storeu_ps((field == 0 ? velocityX : velocityY) + i, result);
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		float cellX = glm::clamp((worldX[i] - worldMin) * scale - 0.5f, 0.0f, maxCell);
+		float cellY = glm::clamp((worldMax - worldZ[i]) * scale - 0.5f, 0.0f, maxCell);
+		float baseX = glm::min((float)(int)cellX, maxBase);
+		float baseY = glm::min((float)(int)cellY, maxBase);
+		float tx    = cellX - baseX;
+		float ty    = cellY - baseY;
+		int   index = (int)baseY * resolution + (int)baseX;
+
+		const float *cellVelX = velX + index;
+		float top    = cellVelX[0] + tx * (cellVelX[1] - cellVelX[0]);
+		float bottom = cellVelX[resolution] + tx * (cellVelX[resolution + 1] - cellVelX[resolution]);
+		velocityX[i] = top + ty * (bottom - top);
+
+		const float *cellVelY = velY + index;
+		top          = cellVelY[0] + tx * (cellVelY[1] - cellVelY[0]);
+		bottom       = cellVelY[resolution] + tx * (cellVelY[resolution + 1] - cellVelY[resolution]);
+		velocityY[i] = top + ty * (bottom - top);
+	}
+}
+
 void FluidGrid::addDensityAt(int x, int y, float d)
 {
 	densityPrev[INDEX(x, y)] = d;
@@ -381,6 +569,23 @@ void FluidGrid::addVelocityAt(int x, int y, float vX, float vY)
 	velYPrev[INDEX(x, y)] = vY;
 }
 
+void FluidGrid::applyFans(const std::vector<Fan>& fans)
+{
+	for (const Fan& fan : fans)
+	{
+		if (!fan.active)
+		{
+			continue;
+		}
+
+		int x = (int)(N * fan.position.x);
+		int y = (int)(N * fan.position.y);
+
+		addVelocityAt(x, y, fan.velocity.x, -fan.velocity.y);
+		addDensityAt(x, y, fan.density);
+	}
+}
+
 void FluidGrid::clearCurrent()
 {
 	memset(densityPrev, 0, sizeof(float) * size);
@@ -388,11 +593,179 @@ void FluidGrid::clearCurrent()
 	memset(velYPrev, 0, sizeof(float) * size);
 }
 
+bool FluidGrid::saveState(const std::string &path)
+{
+	// The arena may be a mapping of path itself, it must not be truncated
+	// while it is mapped. The snapshot replaces it once it is complete.
+	std::string tempPath = path + ".tmp";
+	FILE *file = fopen(tempPath.c_str(), "wb");
+	if (!file)
+	{
+		LOG_ERROR("Could not open '%s' for writing the fluid grid snapshot", tempPath.c_str());
+		return false;
+	}
+
+	std::vector<FluidGridSnapshotFan> fans;
+	if (config)
+	{
+		for (const Fan &fan : config->fans)
+		{
+			fans.push_back({ fan.active ? 1u : 0u, fan.position.x, fan.position.y,
+				fan.velocity.x, fan.velocity.y, fan.density });
+		}
+	}
+
+	unsigned char headerBlock[FLUID_GRID_SNAPSHOT_FIELDS_OFFSET] = {};
+	FluidGridSnapshotHeader header{};
+	memcpy(header.magic, FLUID_GRID_SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.version      = FLUID_GRID_SNAPSHOT_VERSION;
+	header.N            = (uint32_t)N;
+	header.diffusion    = diff;
+	header.viscosity    = visc;
+	header.fanCount     = (uint32_t)fans.size();
+	header.fieldsOffset = FLUID_GRID_SNAPSHOT_FIELDS_OFFSET;
+	header.fansOffset   = FLUID_GRID_SNAPSHOT_FIELDS_OFFSET + FLUID_GRID_FIELDS * size * (uint32_t)sizeof(float);
+	memcpy(headerBlock, &header, sizeof(header));
+
+	// The fields are written by name, the swaps may have reordered them in the arena
+	const float *fields[FLUID_GRID_FIELDS] = { density, densityPrev, velX, velY, velXPrev, velYPrev };
+
+	bool success = fwrite(headerBlock, sizeof(headerBlock), 1, file) == 1;
+	for (int i = 0; i < FLUID_GRID_FIELDS && success; i++)
+	{
+		success = fwrite(fields[i], sizeof(float), size, file) == (size_t)size;
+	}
+	if (success && !fans.empty())
+	{
+		success = fwrite(fans.data(), sizeof(FluidGridSnapshotFan), fans.size(), file) == fans.size();
+	}
+
+	success = fclose(file) == 0 && success;
+
+	if (!success)
+	{
+		LOG_ERROR("Failed writing the fluid grid snapshot to '%s'", tempPath.c_str());
+		remove(tempPath.c_str());
+		return false;
+	}
+
+#ifdef _WIN32
+	// Windows cannot replace a mapped file, and rename does not replace
+	// existing files
+	if (snapshotMapping)
+	{
+		ownArena();
+	}
+	if (!MoveFileExA(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+	{
+		// The old snapshot is still in place, the new one is kept next to it
+		LOG_ERROR("Could not replace '%s' with the new fluid grid snapshot, it is left in '%s'",
+			path.c_str(), tempPath.c_str());
+		return false;
+	}
+#else
+	if (rename(tempPath.c_str(), path.c_str()) != 0)
+	{
+		LOG_ERROR("Could not replace '%s' with the new fluid grid snapshot", path.c_str());
+		remove(tempPath.c_str());
+		return false;
+	}
+#endif
+	return true;
+}
+
+bool FluidGrid::loadState(const std::string &path)
+{
+	MappedFile *mapping = new MappedFile();
+	if (!mapping->open(path, true))
+	{
+		delete mapping;
+		return false;
+	}
+
+	const FluidGridSnapshotHeader *header = (const FluidGridSnapshotHeader *)mapping->data();
+	bool valid = mapping->size() >= sizeof(FluidGridSnapshotHeader) &&
+		memcmp(header->magic, FLUID_GRID_SNAPSHOT_MAGIC, sizeof(header->magic)) == 0 &&
+		header->version == FLUID_GRID_SNAPSHOT_VERSION;
+
+	if (valid)
+	{
+		// Widened before adding. With N bounded and 32 bit offsets and counts
+		// none of the ends can wrap around in 64 bits.
+		uint64_t snapshotN    = header->N;
+		uint64_t snapshotSize = (snapshotN + 2) * (snapshotN + 2);
+		uint64_t fieldsEnd    = (uint64_t)header->fieldsOffset + FLUID_GRID_FIELDS * snapshotSize * sizeof(float);
+		uint64_t fansEnd      = (uint64_t)header->fansOffset + (uint64_t)header->fanCount * sizeof(FluidGridSnapshotFan);
+		valid = header->N > 0 && header->N <= FLUID_GRID_SNAPSHOT_MAX_N &&
+			header->fieldsOffset % alignof(float) == 0 &&
+			header->fansOffset % alignof(FluidGridSnapshotFan) == 0 &&
+			fieldsEnd <= mapping->size() && fansEnd <= mapping->size();
+	}
+
+	if (!valid)
+	{
+		LOG_ERROR("'%s' is not a valid version %u fluid grid snapshot", path.c_str(), FLUID_GRID_SNAPSHOT_VERSION);
+		delete mapping;
+		return false;
+	}
+
+	releaseArena();
+
+	N    = (int)header->N;
+	size = (N + 2) * (N + 2);
+	diff = header->diffusion;
+	visc = header->viscosity;
+
+	// Simulating writes to private copies of the touched pages, never to the file
+	arena           = (float *)(mapping->writableData() + header->fieldsOffset);
+	ownsArena       = false;
+	snapshotMapping = mapping;
+	assignFields(arena);
+
+	if (config)
+	{
+		const FluidGridSnapshotFan *fans = (const FluidGridSnapshotFan *)(mapping->data() + header->fansOffset);
+		config->fans.clear();
+		for (uint32_t i = 0; i < header->fanCount; i++)
+		{
+			Fan fan{};
+			fan.active   = fans[i].active != 0;
+			fan.position = { fans[i].positionX, fans[i].positionY };
+			fan.velocity = { fans[i].velocityX, fans[i].velocityY };
+			fan.density  = fans[i].density;
+			config->fans.push_back(fan);
+		}
+
+		if (config->selectedFanIndex >= (int)config->fans.size())
+		{
+			config->selectedFanIndex = config->fans.empty() ? -1 : 0;
+		}
+	}
+
+	drawStep();
+	LOG_INFO("Restored a %dx%d fluid grid with %u fans from '%s'", N, N, header->fanCount, path.c_str());
+	return true;
+}
+
 void FluidGrid::drawStep()
 {
-	textureDen->loadTextureSingleChannel(N + 2, density);
-	textureVelX->loadTextureSingleChannel(N + 2, velX);
-	textureVelY->loadTextureSingleChannel(N + 2, velY);
+	uploadFields(density, velX, velY);
+}
+
+void FluidGrid::uploadFields(const float* density, const float* velX, const float* velY)
+{
+	if (publisher)
+	{
+		publisher->publish(density, velX, velY, (uint32_t)(N + 2));
+	}
+
+	// Headless grids have nothing to draw to
+	if (!textureDen)
+		return;
+
+	textureDen->loadTextureSingleChannel(N + 2, (void*)density);
+	textureVelX->loadTextureSingleChannel(N + 2, (void*)velX);
+	textureVelY->loadTextureSingleChannel(N + 2, (void*)velY);
 }
 
 void FluidGrid::simulate(float deltaTime)
@@ -422,6 +795,21 @@ Texture *FluidGrid::getTextureVelY()
 	return textureVelY;
 }
 
+const float *FluidGrid::getDensity() const
+{
+	return density;
+}
+
+const float *FluidGrid::getVelX() const
+{
+	return velX;
+}
+
+const float *FluidGrid::getVelY() const
+{
+	return velY;
+}
+
 float *FluidGrid::getDiffPointer()
 {
 	return &diff;
@@ -431,3 +819,8 @@ float *FluidGrid::getViscPointer()
 {
 	return &visc;
 }
+
+void FluidGrid::setPublisher(WindFieldPublisher *publisher)
+{
+	this->publisher = publisher;
+}
@@ -2,10 +2,13 @@
 #define FLUID_GRID_H
 
 #include <glm/glm.hpp>
+#include <vector>
 
 #include "rendering/texture.h"
+#include "mapped_file.h"
 
 class FluidGrid;
+class WindFieldPublisher;
 
 struct Fan
 {
@@ -34,6 +37,11 @@ struct FluidGridConfig
 class FluidGrid
 {
 public:
+	/**
+	 * \brief Creates a fluid grid of N x N cells.
+	 * \param fluidGridConfig Receives the textures the grid draws to. Pass
+	 * nullptr for a headless grid that only simulates, e.g. for offline baking.
+	 */
 	FluidGrid(int N, float diffusion, float viscosity, FluidGridConfig* fluidGridConfig);
 	~FluidGrid();
 
@@ -48,26 +56,99 @@ public:
 	void project(float* velX, float* velY, float* p, float* div);
 	float totalDensity();
 
+	/**
+	 * \brief Samples the velocity at world space positions, bilinearly
+	 * interpolated between cell centers. Positions are mapped onto the grid
+	 * the same way as Scene::mapPositionFromWorldSpace and blades.vert do, and
+	 * clamped to the grid. Processes four positions at a time with SIMD.
+	 * \param worldX World space x of each position
+	 * \param worldZ World space z of each position
+	 * \param velocityX Receives the x velocity of each position
+	 * \param velocityY Receives the y velocity of each position
+	 */
+	void sampleVelocities(const float* worldX, const float* worldZ, size_t count, float worldMin, float worldMax,
+		float* velocityX, float* velocityY) const;
+
 	void addDensityAt(int x, int y, float d);
 	void addVelocityAt(int x, int y, float vX, float vY);
 
+	/**
+	 * \brief Adds the density and velocity of all active fans.
+	 */
+	void applyFans(const std::vector<Fan>& fans);
+
 	void clearCurrent();
 
+	/**
+	 * \brief Writes the complete solver state, the fields, fans, diffusion
+	 * and viscosity, to a versioned snapshot file. The file is written next
+	 * to path and replaces it once complete, so path may be the snapshot the
+	 * arena is mapped from.
+	 * \return True if the snapshot was written.
+	 */
+	bool saveState(const std::string& path);
+
+	/**
+	 * \brief Restores a snapshot written by saveState. The file is mapped
+	 * copy-on-write and used as the field arena, so nothing is read up front.
+	 * \return True if the snapshot was restored, the state is untouched otherwise.
+	 */
+	bool loadState(const std::string& path);
+
 	void     drawStep();
+
+	/**
+	 * \brief Uploads (N + 2) x (N + 2) fields to the grid textures, and
+	 * publishes them if a publisher is set. This is the upload path of
+	 * drawStep, also used to stream baked wind.
+	 */
+	void     uploadFields(const float* density, const float* velX, const float* velY);
 	void     simulate(float deltaTime);
 	int      getN();
 	Texture* getTextureDen();
 	Texture* getTextureVelX();
 	Texture* getTextureVelY();
+	const float* getDensity() const;
+	const float* getVelX() const;
+	const float* getVelY() const;
 	float* getDiffPointer();
 	float* getViscPointer();
 
+	/**
+	 * \brief Publishes every uploaded frame to other processes, pass nullptr
+	 * to stop publishing.
+	 */
+	void setPublisher(WindFieldPublisher* publisher);
+
 private:
 	int   size;
 	int   N;
 	float diff;
 	float visc;
 
+	FluidGridConfig* config = nullptr;
+	WindFieldPublisher* publisher = nullptr;
+
+	/**
+	 * \brief All six fields live in one arena of consecutive size floats.
+	 * It is either allocated by the grid, or a mapped snapshot.
+	 */
+	float* arena = nullptr;
+	bool ownsArena = true;
+	MappedFile* snapshotMapping = nullptr;
+
+	/**
+	 * \brief Points the fields at consecutive slots of the arena.
+	 */
+	void assignFields(float* arena);
+
+	/**
+	 * \brief Copies the fields out of a mapped snapshot into an allocated
+	 * arena and closes the mapping.
+	 */
+	void ownArena();
+	void releaseArena();
+
 	float* density;
 	float* densityPrev;
 
@@ -82,9 +163,9 @@ private:
 	float* velYSource;
 
 
-	Texture* textureDen;
-	Texture* textureVelX;
-	Texture* textureVelY;
+	Texture* textureDen = nullptr;
+	Texture* textureVelX = nullptr;
+	Texture* textureVelY = nullptr;
 };
 
 #endif
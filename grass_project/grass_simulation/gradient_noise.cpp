@@ -0,0 +1,330 @@
+#include "gradient_noise.h"
+#include "thread_pool.h"
+#include "debug.h"
+
+#include <cmath>
+#include <string>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GRADIENT_NOISE_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+/*
+ * Keep everything in here in sync with gradient_noise.comp. Both evaluate the
+ * same expressions in the same order, so they produce the same values.
+ */
+
+namespace
+{
+	/**
+	 * \brief Rows generated per thread pool job
+	 */
+	const int GRADIENT_NOISE_ROWS_PER_JOB = 16;
+
+	/**
+	 * \brief Maps the noise to [0, 1]. It can reach +-sqrt(0.5), but hardly
+	 * leaves +-0.5, so only rare peaks are clipped.
+	 */
+	const float GRADIENT_NOISE_SCALE = 1.0f;
+
+	const float GRADIENT_DIAGONAL = 0.70710678f;
+	const float GRADIENTS[8][2] = {
+		{ 1.0f, 0.0f }, { -1.0f, 0.0f }, { 0.0f, 1.0f }, { 0.0f, -1.0f },
+		{ GRADIENT_DIAGONAL, GRADIENT_DIAGONAL }, { -GRADIENT_DIAGONAL, GRADIENT_DIAGONAL },
+		{ GRADIENT_DIAGONAL, -GRADIENT_DIAGONAL }, { -GRADIENT_DIAGONAL, -GRADIENT_DIAGONAL }
+	};
+
+	/**
+	 * \brief Gradient of a lattice point
+	 * \param periodMask Cells per period minus one, or -1 if the noise does
+	 * not repeat.
+	 */
+	const float* latticeGradient(int cellX, int cellY, int periodMask, uint32_t octaveSeed)
+	{
+		uint32_t h = (uint32_t)(cellX & periodMask) * 0x8DA6B343u +
+			(uint32_t)(cellY & periodMask) * 0xD8163841u +
+			octaveSeed * 0xCB1AB31Fu;
+		h ^= h >> 16;
+		h *= 0x7FEB352Du;
+		h ^= h >> 15;
+		h *= 0x846CA68Bu;
+		h ^= h >> 16;
+		return GRADIENTS[h & 7];
+	}
+
+	inline float fade(float t)
+	{
+		return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+	}
+
+	struct OctaveSettings
+	{
+		int      pitchShift;
+		int      periodMask;
+		uint32_t seed;
+		float    weight;
+	};
+
+	/**
+	 * \brief Adds one octave to a row of noise that starts at originX. Pixels
+	 * within one lattice cell share their gradients, so the row is walked cell
+	 * by cell and every cell is filled four pixels at a time.
+	 */
+	void addOctaveToRow(float* row, int originX, int width, int y, const OctaveSettings& octave)
+	{
+		const int pitchShift = octave.pitchShift;
+		const int cellMask = (1 << pitchShift) - 1;
+		const float invPitch = std::ldexp(1.0f, -pitchShift);
+
+		const int cellY = y >> pitchShift;
+		const float fy = ((float)(y & cellMask) + 0.5f) * invPitch;
+		const float fyBelow = fy - 1.0f;
+		const float v = fade(fy);
+
+		int x = originX;
+		const int endX = originX + width;
+		while (x < endX)
+		{
+			int cellX = x >> pitchShift;
+			int spanEnd = ((cellX + 1) << pitchShift) < endX ? ((cellX + 1) << pitchShift) : endX;
+
+			const float* g00 = latticeGradient(cellX, cellY, octave.periodMask, octave.seed);
+			const float* g10 = latticeGradient(cellX + 1, cellY, octave.periodMask, octave.seed);
+			const float* g01 = latticeGradient(cellX, cellY + 1, octave.periodMask, octave.seed);
+			const float* g11 = latticeGradient(cellX + 1, cellY + 1, octave.periodMask, octave.seed);
+
+			// The y halves of the dot products are the same for the whole span
+			const float a00 = g00[1] * fy;
+			const float a10 = g10[1] * fy;
+			const float a01 = g01[1] * fyBelow;
+			const float a11 = g11[1] * fyBelow;
+
+			float* out = row + (x - originX);
+			int i = 0;
+			const int count = spanEnd - x;
+			const int localX = x & cellMask;
+
+#ifdef GRADIENT_NOISE_USE_SSE2
+			if (count >= 4)
+			{
+				const __m128 halfV = _mm_set1_ps(0.5f);
+				const __m128 oneV = _mm_set1_ps(1.0f);
+				const __m128 sixV = _mm_set1_ps(6.0f);
+				const __m128 fifteenV = _mm_set1_ps(15.0f);
+				const __m128 tenV = _mm_set1_ps(10.0f);
+				const __m128 invPitchV = _mm_set1_ps(invPitch);
+				const __m128 vV = _mm_set1_ps(v);
+				const __m128 weightV = _mm_set1_ps(octave.weight);
+				const __m128 g00x = _mm_set1_ps(g00[0]), a00V = _mm_set1_ps(a00);
+				const __m128 g10x = _mm_set1_ps(g10[0]), a10V = _mm_set1_ps(a10);
+				const __m128 g01x = _mm_set1_ps(g01[0]), a01V = _mm_set1_ps(a01);
+				const __m128 g11x = _mm_set1_ps(g11[0]), a11V = _mm_set1_ps(a11);
+
+				for (; i + 4 <= count; i += 4)
+				{
+					__m128i local = _mm_add_epi32(_mm_set1_epi32(localX + i), _mm_set_epi32(3, 2, 1, 0));
+					__m128 fx = _mm_mul_ps(_mm_add_ps(_mm_cvtepi32_ps(local), halfV), invPitchV);
+					__m128 fxRight = _mm_sub_ps(fx, oneV);
+					__m128 u = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(fx, fx), fx),
+						_mm_add_ps(_mm_mul_ps(fx, _mm_sub_ps(_mm_mul_ps(fx, sixV), fifteenV)), tenV));
+
+					__m128 d00 = _mm_add_ps(_mm_mul_ps(g00x, fx), a00V);
+					__m128 d10 = _mm_add_ps(_mm_mul_ps(g10x, fxRight), a10V);
+					__m128 d01 = _mm_add_ps(_mm_mul_ps(g01x, fx), a01V);
+					__m128 d11 = _mm_add_ps(_mm_mul_ps(g11x, fxRight), a11V);
+
+					__m128 top = _mm_add_ps(d00, _mm_mul_ps(u, _mm_sub_ps(d10, d00)));
+					__m128 bottom = _mm_add_ps(d01, _mm_mul_ps(u, _mm_sub_ps(d11, d01)));
+					__m128 noise = _mm_add_ps(top, _mm_mul_ps(vV, _mm_sub_ps(bottom, top)));
+
+					_mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(noise, weightV)));
+				}
+			}
+#endif
+
+			for (; i < count; i++)
+			{
+				float fx = ((float)(localX + i) + 0.5f) * invPitch;
+				float fxRight = fx - 1.0f;
+				float u = fade(fx);
+
+				float d00 = g00[0] * fx + a00;
+				float d10 = g10[0] * fxRight + a10;
+				float d01 = g01[0] * fx + a01;
+				float d11 = g11[0] * fxRight + a11;
+
+				float top = d00 + u * (d10 - d00);
+				float bottom = d01 + u * (d11 - d01);
+				float noise = top + v * (bottom - top);
+
+				out[i] += noise * octave.weight;
+			}
+
+			x = spanEnd;
+		}
+	}
+
+	/**
+	 * \brief Fills the rows [rowBegin, rowEnd) of output. Octaves is a
+	 * template parameter, so the octave loop is unrolled.
+	 */
+	template<int Octaves>
+	void gradientNoiseRows(const OctaveSettings* octaves, int originX, int originY, int width,
+		size_t rowBegin, size_t rowEnd, float* output)
+	{
+		static_assert(Octaves >= 1 && Octaves <= MAX_GRADIENT_NOISE_OCTAVES, "Unsupported octave count");
+
+		for (size_t rowIndex = rowBegin; rowIndex < rowEnd; rowIndex++)
+		{
+			float* row = output + rowIndex * width;
+			for (int x = 0; x < width; x++)
+				row[x] = 0.0f;
+
+			for (int o = 0; o < Octaves; o++)
+			{
+				addOctaveToRow(row, originX, width, originY + (int)rowIndex, octaves[o]);
+			}
+
+			for (int x = 0; x < width; x++)
+			{
+				float value = row[x] * GRADIENT_NOISE_SCALE + 0.5f;
+				row[x] = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+			}
+		}
+	}
+
+	typedef void (*GradientNoiseRowsFunction)(const OctaveSettings*, int, int, int, size_t, size_t, float*);
+
+	const GradientNoiseRowsFunction GRADIENT_NOISE_ROWS[MAX_GRADIENT_NOISE_OCTAVES] = {
+		gradientNoiseRows<1>, gradientNoiseRows<2>, gradientNoiseRows<3>, gradientNoiseRows<4>,
+		gradientNoiseRows<5>, gradientNoiseRows<6>, gradientNoiseRows<7>, gradientNoiseRows<8>,
+		gradientNoiseRows<9>, gradientNoiseRows<10>
+	};
+
+	int powerOfTwoShift(int value)
+	{
+		int shift = 0;
+		while ((1 << shift) < value)
+			shift++;
+		return shift;
+	}
+
+	/**
+	 * \brief Works out the lattice, seed and weight of every octave.
+	 * \return The number of octaves.
+	 */
+	int octaveSettings(const GradientNoiseSettings& settings, OctaveSettings* octaves)
+	{
+		int count = gradientNoiseOctaves(settings);
+		int pitchShift = powerOfTwoShift(settings.pitch);
+
+		float scaleAcc = 0.0f;
+		float scale = 1.0f;
+		for (int o = 0; o < count; o++)
+		{
+			octaves[o].pitchShift = pitchShift - o;
+			octaves[o].periodMask = settings.period > 0 ? (settings.period >> octaves[o].pitchShift) - 1 : -1;
+			octaves[o].seed = settings.seed + (uint32_t)o * 0x9E3779B9u;
+			octaves[o].weight = scale;
+			scaleAcc += scale;
+			scale = scale / settings.bias;
+		}
+		for (int o = 0; o < count; o++)
+			octaves[o].weight /= scaleAcc;
+
+		return count;
+	}
+
+	bool isPowerOfTwo(int value)
+	{
+		return value > 0 && (value & (value - 1)) == 0;
+	}
+
+	bool validateSettings(const GradientNoiseSettings& settings)
+	{
+		if (!isPowerOfTwo(settings.pitch))
+		{
+			LOG_ERROR("Gradient noise pitch has to be a power of two, but was %d", settings.pitch);
+			return false;
+		}
+		if (settings.period != 0 && (!isPowerOfTwo(settings.period) || settings.period < settings.pitch))
+		{
+			LOG_ERROR("Gradient noise period has to be 0 or a power of two of at least the pitch, but was %d", settings.period);
+			return false;
+		}
+		return true;
+	}
+}
+
+int gradientNoiseOctaves(const GradientNoiseSettings& settings)
+{
+	int maxOctaves = powerOfTwoShift(settings.pitch) + 1;
+	maxOctaves = maxOctaves < MAX_GRADIENT_NOISE_OCTAVES ? maxOctaves : MAX_GRADIENT_NOISE_OCTAVES;
+	return glm::clamp(settings.octaves, 1, maxOctaves);
+}
+
+void gradientNoise2DCPU(const GradientNoiseSettings& settings, int originX, int originY, int width, int height,
+	float* output, ThreadPool* threadPool)
+{
+	if (!validateSettings(settings))
+		return;
+
+	OctaveSettings octaves[MAX_GRADIENT_NOISE_OCTAVES];
+	int octaveCount = octaveSettings(settings, octaves);
+	GradientNoiseRowsFunction rows = GRADIENT_NOISE_ROWS[octaveCount - 1];
+
+	auto generateRows = [&](size_t begin, size_t end)
+	{
+		rows(octaves, originX, originY, width, begin, end, output);
+	};
+
+	if (threadPool)
+	{
+		threadPool->parallelFor((size_t)height, GRADIENT_NOISE_ROWS_PER_JOB, generateRows);
+	}
+	else
+	{
+		generateRows(0, (size_t)height);
+	}
+}
+
+void gradientNoise2DGPU(const GradientNoiseSettings& settings, int originX, int originY, int width, int height,
+	ShaderProgram* computeShaderProgram, GLuint computeShaderTexture)
+{
+	if (!validateSettings(settings))
+		return;
+
+	OctaveSettings octaves[MAX_GRADIENT_NOISE_OCTAVES];
+	int octaveCount = octaveSettings(settings, octaves);
+
+	float weights[MAX_GRADIENT_NOISE_OCTAVES];
+	int periodMasks[MAX_GRADIENT_NOISE_OCTAVES];
+	for (int o = 0; o < octaveCount; o++)
+	{
+		weights[o] = octaves[o].weight;
+		periodMasks[o] = octaves[o].periodMask;
+	}
+
+	computeShaderProgram->use();
+
+	GLCall(glBindImageTexture(0, computeShaderTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R8));
+
+	computeShaderProgram->setIVec2("origin", originX, originY);
+	computeShaderProgram->setIVec2("size", width, height);
+	computeShaderProgram->setInt("pitchShift", octaves[0].pitchShift);
+	computeShaderProgram->setUint("seed", settings.seed);
+	GLCall(glUniform1fv(computeShaderProgram->getUniformLocation("weights"), octaveCount, weights));
+	GLCall(glUniform1iv(computeShaderProgram->getUniformLocation("periodMasks"), octaveCount, periodMasks));
+
+	GLCall(glDispatchCompute((width + 15) / 16, (height + 15) / 16, 1));
+}
+
+ShaderProgram* createGradientNoiseComputeShaderProgram(int octaves, Shader** computeShader)
+{
+	octaves = glm::clamp(octaves, 1, MAX_GRADIENT_NOISE_OCTAVES);
+
+	*computeShader = new Shader("assets/shaders/gradient_noise.comp", GL_COMPUTE_SHADER,
+		{ "OCTAVES " + std::to_string(octaves) });
+	return new ShaderProgram({ *computeShader }, "GRADIENT NOISE COMPUTE SHADER " + std::to_string(octaves));
+}
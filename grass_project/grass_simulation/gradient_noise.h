@@ -0,0 +1,68 @@
+#ifndef GRADIENT_NOISE_H
+#define GRADIENT_NOISE_H
+
+#include <cstdint>
+
+#include "rendering/shader_program.h"
+
+class ThreadPool;
+
+/**
+ * \brief Most octaves gradient noise is specialized for
+ */
+const int MAX_GRADIENT_NOISE_OCTAVES = 10;
+
+/**
+ * \brief Settings of gradient noise.
+ * seed:	Picks the gradients of the lattice, there is no seed texture.
+ * pitch:	Pixels per lattice cell of the first octave, a power of two. Every
+ *			further octave halves it, octaves below a pixel are dropped.
+ * period:	The noise repeats every period pixels, so a texture of that size
+ *			tiles. A power of two of at least pitch, or 0 for noise that never
+ *			repeats.
+ */
+struct GradientNoiseSettings
+{
+	int      octaves = 6;
+	float    bias = 1.0f;
+	uint32_t seed = 1;
+	int      pitch = 512;
+	int      period = 512;
+};
+
+/**
+ * \brief Generates gradient noise in [0, 1] for the pixels [originX, originX +
+ * width) x [originY, originY + height) of the infinite noise plane, row by row
+ * into output. The octave loop is specialized for every octave count.
+ * \param threadPool Splits the rows between its threads. Generates on the
+ * calling thread if nullptr.
+ */
+void gradientNoise2DCPU(const GradientNoiseSettings& settings, int originX, int originY, int width, int height,
+	float* output, ThreadPool* threadPool = nullptr);
+
+/**
+ * \brief Generates the same noise as gradientNoise2DCPU on the GPU, into a
+ * single channel image texture. The image is treated as a torus, pixel
+ * (x, y) of the noise plane is written to (x, y) modulo the size of the image,
+ * which has to be a power of two.
+ * \param computeShaderProgram Created by createGradientNoiseComputeShaderProgram
+ * for the octaves of settings.
+ */
+void gradientNoise2DGPU(const GradientNoiseSettings& settings, int originX, int originY, int width, int height,
+	ShaderProgram* computeShaderProgram, GLuint computeShaderTexture);
+
+/**
+ * \brief Compiles the gradient noise compute shader with its octave loop
+ * specialized for octaves.
+ * \param computeShader Receives the compute shader, delete it along with the
+ * program.
+ */
+ShaderProgram* createGradientNoiseComputeShaderProgram(int octaves, Shader** computeShader);
+
+/**
+ * \brief Octaves that are actually generated for settings. Octaves past a
+ * pitch of one pixel are dropped.
+ */
+int gradientNoiseOctaves(const GradientNoiseSettings& settings);
+
+#endif
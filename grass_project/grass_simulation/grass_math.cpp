@@ -109,3 +109,58 @@ std::optional<glm::vec3> Ray::intersectsLine(const glm::vec3& p1, const glm::vec
 	return std::nullopt;
 }
 
+Frustum::Frustum(const glm::mat4& viewProjection) {
+	// Rows of the matrix, glm is column major
+	glm::vec4 row[4];
+	for (int i = 0; i < 4; i++) {
+		row[i] = { viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i] };
+	}
+
+	planes[0] = row[3] + row[0]; // Left
+	planes[1] = row[3] - row[0]; // Right
+	planes[2] = row[3] + row[1]; // Bottom
+	planes[3] = row[3] - row[1]; // Top
+	planes[4] = row[3] + row[2]; // Near
+	planes[5] = row[3] - row[2]; // Far
+
+	// Normalized, so the plane equation gives distances
+	for (glm::vec4& plane : planes) {
+		plane /= glm::length(glm::vec3(plane));
+	}
+}
+
+bool Frustum::intersectsSphere(const glm::vec3& center, float radius) const {
+	for (const glm::vec4& plane : planes) {
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+			return false;
+	}
+	return true;
+}
+
+bool Frustum::intersectsBox(const glm::vec3& min, const glm::vec3& max) const {
+	for (const glm::vec4& plane : planes) {
+		// The corner furthest along the plane normal
+		glm::vec3 corner = {
+			plane.x >= 0.0f ? max.x : min.x,
+			plane.y >= 0.0f ? max.y : min.y,
+			plane.z >= 0.0f ? max.z : min.z
+		};
+		if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+bool Frustum::containsBox(const glm::vec3& min, const glm::vec3& max) const {
+	for (const glm::vec4& plane : planes) {
+		// The corner furthest against the plane normal
+		glm::vec3 corner = {
+			plane.x >= 0.0f ? min.x : max.x,
+			plane.y >= 0.0f ? min.y : max.y,
+			plane.z >= 0.0f ? min.z : max.z
+		};
+		if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+			return false;
+	}
+	return true;
+}
@@ -20,6 +20,32 @@ public:
 	std::optional<glm::vec3> intersectsLine(const glm::vec3& p1, const glm::vec3& p2);
 };
 
+/**
+ * \brief The six planes of a view frustum, facing inwards. A point p is on
+ * the inside of a plane if dot(plane.xyz, p) + plane.w >= 0.
+ */
+struct Frustum {
+	glm::vec4 planes[6];
+
+	/**
+	 * \brief Extracts the planes of projection * view
+	 */
+	explicit Frustum(const glm::mat4& viewProjection);
+
+	bool intersectsSphere(const glm::vec3& center, float radius) const;
+
+	/**
+	 * \brief Conservative, may report boxes near the corners of the frustum
+	 * that are actually outside.
+	 */
+	bool intersectsBox(const glm::vec3& min, const glm::vec3& max) const;
+
+	/**
+	 * \brief Whether the box is entirely inside the frustum
+	 */
+	bool containsBox(const glm::vec3& min, const glm::vec3& max) const;
+};
+
 inline float map(float s, float a1, float a2, float b1, float b2)
 {
 	return b1 + (s - a1) * (b2 - b1) / (a2 - a1);
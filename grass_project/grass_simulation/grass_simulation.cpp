@@ -2,22 +2,39 @@
 #include <rendering/texture.h>
 #include "patch.h"
 #include "fluid_grid.h"
+#include "gradient_noise.h"
+#include "wind_flipbook.h"
+#include "wind_field_publisher.h"
+#include "particle_system.h"
+#include "wind_texture_cache.h"
+#include "streaming_noise.h"
+#include "wind_texture_pipeline.h"
+#include "blade_culler.h"
+#include "patch_field.h"
+#include "impostor_cards.h"
 #include "logger.h"
+#include "thread_pool.h"
+#include <rendering/gpu_timer.h>
+#include <rendering/mesh_registry.h>
 #include <rendering/scene_object_indexed.h>
 #include <rendering/primitives.h>
 #include <rendering/scene_object_instanced.h>
+#include <rendering/scene_object_multi_draw.h>
 #include <rendering/scene_object_arrays.h>
+#include <rendering/gl_state.h>
 #include <imgui.h>
 #include <gui_helpers.h>
+#include <climits>
+#include <filesystem>
 
 namespace GrassSimulation {
 	Scene* g_scene;
 	Inputs& inputs = Inputs::instance();
 
 	/**
-	 * \brief Id of the instance matrix buffer for rendering blade-instances
+	 * \brief Id of the BladeInstance buffer for rendering blade-instances
 	*/
-	unsigned int instanceMatrixBuffer;
+	unsigned int bladeInstanceBuffer;
 
 	bool clearNextSimulate = true;
 
@@ -34,9 +51,9 @@ namespace GrassSimulation {
 
 
 	/**
-	 * \brief PerlinSeed texture
+	 * \brief Times the wind noise generation on the GPU
 	*/
-	Texture* perlinNoiseSeedTexture;
+	GpuTimer* noiseGpuTimer;
 
 
 #define CHECKER_PATTERN_TEXTURE_WIDTH 512
@@ -47,9 +64,35 @@ namespace GrassSimulation {
 	const int MAX_BLADES_PER_PATCH = 1000;
 
 	/**
-	 * \brief Max number patches
+	 * \brief Max number patches. The patches are stored as needed and culled
+	 * with a quadtree, so this only bounds the GUI.
 	 */
-	const int MAX_PATCHES = 81;
+	const int MAX_PATCHES = 256 * 256;
+
+	/**
+	 * \brief Blades density of procedural blades. They read nothing per blade,
+	 * the blades of all patches only have to count in an int.
+	 */
+	const int MAX_PROCEDURAL_BLADES_PER_PATCH = INT_MAX / MAX_PATCHES;
+
+	/**
+	 * \brief Most blades a patch may have with config. Blades copied from the
+	 * instance buffer are limited to its size.
+	 */
+	int maxBladesPerPatch(const Config& config)
+	{
+		return config.proceduralBlades ? MAX_PROCEDURAL_BLADES_PER_PATCH : MAX_BLADES_PER_PATCH;
+	}
+
+	/**
+	 * \brief Number of patches if the config does not set it
+	 */
+	const int DEFAULT_PATCHES = 81;
+
+	/**
+	 * \brief Max number of wind particles
+	 */
+	const int MAX_PARTICLES = 65536;
 
 
 	/**
@@ -76,6 +119,24 @@ namespace GrassSimulation {
 	*/
 	ShaderProgram* bladesShaderProgram;
 
+	/**
+	 * \brief Shaders that expand one control point per blade into a curved
+	 * blade
+	*/
+	Shader* tessellatedBladesVertexShader;
+	Shader* tessellatedBladesControlShader;
+	Shader* tessellatedBladesEvaluationShader;
+	ShaderProgram* tessellatedBladesShaderProgram;
+
+	/**
+	 * \brief The blade shaders with PROCEDURAL_BLADES_DEFINE, that read no
+	 * instance attributes
+	*/
+	Shader* proceduralBladesVertexShader;
+	ShaderProgram* proceduralBladesShaderProgram;
+	Shader* proceduralTessellatedBladesVertexShader;
+	ShaderProgram* proceduralTessellatedBladesShaderProgram;
+
 	/**
 	 * \brief Vertex shader for the patch
 	*/
@@ -91,6 +152,21 @@ namespace GrassSimulation {
 	*/
 	ShaderProgram* patchShaderProgram;
 
+	/**
+	 * \brief Vertex shader for the wind particles
+	*/
+	Shader* particlesVertexShader;
+
+	/**
+	 * \brief Fragment shader for the wind particles
+	*/
+	Shader* particlesFragmentShader;
+
+	/**
+	 * \brief Shader program for wind particle rendering
+	*/
+	ShaderProgram* particlesShaderProgram;
+
 
 	/**
 	 * \brief Perlin noise compute shader
@@ -102,6 +178,17 @@ namespace GrassSimulation {
 	*/
 	ShaderProgram* perlinNoiseComputeShaderProgram;
 
+	/**
+	 * \brief Gradient noise compute shaders, one per octave count, compiled
+	 * when first used
+	*/
+	Shader* gradientNoiseComputeShaders[MAX_GRADIENT_NOISE_OCTAVES] = {};
+
+	/**
+	 * \brief Gradient noise compute shader programs, one per octave count
+	*/
+	ShaderProgram* gradientNoiseComputeShaderPrograms[MAX_GRADIENT_NOISE_OCTAVES] = {};
+
 	/**
 	 * \brief Checker pattern compute shader
 	*/
@@ -117,16 +204,73 @@ namespace GrassSimulation {
 	*/
 	FluidGrid* fluidGrid;
 
+	/**
+	 * \brief Baked fluid grid wind, played back in FLUID_FLIPBOOK mode
+	*/
+	WindFlipbook windFlipbook;
+
+	/**
+	 * \brief Path the flipbook is baked to and played back from
+	*/
+	char windFlipbookPath[256] = "wind.flipbook";
+
+	/**
+	 * \brief Painted density map, loaded from the GUI
+	*/
+	char densityMapPath[256] = "density_map.png";
+
+	/**
+	 * \brief Path of the fluid grid snapshot, restored on startup if it exists
+	*/
+	char fluidGridSnapshotPath[256] = "wind.snapshot";
+
+	/**
+	 * \brief Shares the live wind field with other processes
+	*/
+	WindFieldPublisher windFieldPublisher;
+
+	/**
+	 * \brief Particles carried by the fluid grid wind
+	*/
+	ParticleSystem* particleSystem;
+
+	/**
+	 * \brief Worker threads for CPU work that is split up, like the particles
+	*/
+	ThreadPool* threadPool;
+
+	/**
+	 * \brief GPU memory the generated wind textures may take, 16 textures of
+	 * 512 x 512
+	*/
+	const size_t WIND_TEXTURE_CACHE_BYTES = 4 * 1024 * 1024;
+
+	/**
+	 * \brief Recently generated perlin noise and checker pattern textures
+	*/
+	WindTextureCache* windTextureCache;
+
+	/**
+	 * \brief Swaps generated wind textures in once the GPU finished them
+	*/
+	WindTexturePipeline* windTexturePipeline;
+
+	/**
+	 * \brief Non-repeating noise that follows the wind, used instead of the
+	 * perlin noise texture when streaming
+	*/
+	StreamingNoise* streamingNoise;
+
 	/**
 	 * \brief Perlin noise texture data, used for uploading perlin noise data
 	*/
 	float* perlinNoiseTextureData;
 
 	/**
-	 * \brief Perlin noise seed texture data, used for uploading perlin noise
-	 * seed data.
+	 * \brief Lattice values of the value noise, only used when generating it on
+	 * the CPU. The GPU hashes them itself.
 	*/
-	float* perlinNoiseSeedTextureData;
+	float* perlinNoiseSeedData;
 
 
 	/**
@@ -135,7 +279,8 @@ namespace GrassSimulation {
 	void initShadersAndTextures();
 
 	/**
-	 * \brief Generates a checker pattern texture.
+	 * \brief Generates a checker pattern texture, or takes it from the wind
+	 * texture cache. The new texture is used once the GPU finished it.
 	 */
 	void generateCheckerPatternTexture();
 
@@ -149,6 +294,17 @@ namespace GrassSimulation {
 	 */
 	void setWindTexturesForSimulationMode();
 
+	/**
+	 * \brief Generated textures the config refers to or will refer to once
+	 * they are done, which the cache must keep.
+	 */
+	std::vector<const Texture*> getWindTexturesInUse();
+
+	/**
+	 * \brief Shows how full the wind texture cache is.
+	 */
+	void drawWindTextureCacheStats();
+
 	/**
 	 * \brief Calculate the spiral position given an index. See this documentation
 	 * for details.
@@ -169,23 +325,80 @@ namespace GrassSimulation {
 	void initSceneObjects(Patch& patch);
 
 	/**
-	 * \brief Generate perlin noise.
+	 * \brief Generate perlin noise, or take it from the wind texture cache.
+	 * The new texture is used once the GPU finished it.
 	*/
 	void generatePerlinNoiseTexture();
 
+	/**
+	 * \brief Generates gradient noise into texture.
+	*/
+	void generateGradientNoiseTexture(Texture* texture);
+
+	/**
+	 * \brief Generates value noise into texture.
+	*/
+	void generateValueNoiseTexture(Texture* texture);
+
+	/**
+	 * \brief Generates the density map from gradient noise with the seed of
+	 * DensityMapConfig.
+	*/
+	void generateDensityMap();
+
+	/**
+	 * \brief Loads a painted density map from densityMapPath, its red channel
+	 * is the density.
+	*/
+	void loadDensityMap();
+
+	/**
+	 * \brief Points the config at a cached wind texture, unless it is still
+	 * being generated for target.
+	*/
+	void useCachedWindTexture(Texture** target, Texture* texture);
+
+	/**
+	 * \brief Moves the wind textures along the wind direction.
+	*/
+	void updateWindOffset();
+
+	/**
+	 * \brief Generates the streaming noise the wind moved into view.
+	*/
+	void updateStreamingNoise();
+
 	/**
 	 * @brief Creates the blades instance buffer.
 	 * @param modelMatrices The matrix data.
 	 * @param maxBlades The maximum number of blades.
 	*/
-	void createInstanceMatrixBuffer(glm::mat4* modelMatrices, const unsigned int maxBlades);
+	void createBladeInstanceBuffer(BladeInstance* bladeInstances, const unsigned int maxBlades);
 
 	/**
 	 * @brief Transfers the instance matrix buffer to the GPU.
 	 * @param modelMatrices The matrix data to transfer.
 	 * @param numInstances The number of instances.
 	*/
-	void transferInstanceMatrixBuffer(glm::mat4* modelMatrices, const unsigned int numInstances);
+	void transferBladeInstanceBuffer(BladeInstance* bladeInstances, const unsigned int numInstances);
+
+	/**
+	 * \brief Bakes the blades of the template patch into the impostor cards,
+	 * after the blades or their number changed.
+	*/
+	void bakeImpostorCards();
+
+	/**
+	 * \brief Lays out config.numPatches patches in a spiral, rebuilds the
+	 * patch field and fits the world around it.
+	*/
+	void updatePatchModels();
+
+	/**
+	 * \brief Fits the world, which the wind textures and the fluid grid span,
+	 * around the patches.
+	*/
+	void setWorldMinMax();
 
 
 	// RETURNS NULL IF NONE IS SELECTED
@@ -208,6 +421,8 @@ namespace GrassSimulation {
 	glm::vec3 g_fanDragStart = {};
 	bool g_fanIsDragging = false;
 	void drawFanWindow();
+	void drawFlipbookBakeSettings();
+	void drawParticleSettings();
 
 	struct GrassSimullationConfig
 	{
@@ -303,24 +518,53 @@ namespace GrassSimulation {
 
 	void initShadersAndTextures()
 	{
-		bladesVertexShader = new Shader("assets/shaders/blades.vert", GL_VERTEX_SHADER);
+		// The patches and blades index their model matrices with gl_DrawIDARB
+		// if the driver has it
+		std::vector<std::string> multiDrawDefines;
+		if (SceneObjectMultiDraw::isDrawIdSupported())
+			multiDrawDefines.push_back(MULTI_DRAW_ID_DEFINE);
+
+		bladesVertexShader = new Shader("assets/shaders/blades.vert", GL_VERTEX_SHADER, multiDrawDefines);
 		bladesFragmentShader = new Shader("assets/shaders/blades.frag", GL_FRAGMENT_SHADER);
 
 		bladesShaderProgram = new ShaderProgram({ bladesVertexShader, bladesFragmentShader }, "BLADES SHADER");
 
-		patchVertexShader = new Shader("assets/shaders/patch.vert", GL_VERTEX_SHADER);
+		tessellatedBladesVertexShader = new Shader("assets/shaders/blades_tess.vert", GL_VERTEX_SHADER, multiDrawDefines);
+		tessellatedBladesControlShader = new Shader("assets/shaders/blades.tesc", GL_TESS_CONTROL_SHADER);
+		tessellatedBladesEvaluationShader = new Shader("assets/shaders/blades.tese", GL_TESS_EVALUATION_SHADER);
+
+		tessellatedBladesShaderProgram = new ShaderProgram({ tessellatedBladesVertexShader,
+			tessellatedBladesControlShader, tessellatedBladesEvaluationShader, bladesFragmentShader },
+			"TESSELLATED BLADES SHADER");
+
+		std::vector<std::string> proceduralDefines = multiDrawDefines;
+		proceduralDefines.push_back(PROCEDURAL_BLADES_DEFINE);
+		proceduralBladesVertexShader = new Shader("assets/shaders/blades.vert", GL_VERTEX_SHADER, proceduralDefines);
+		proceduralBladesShaderProgram = new ShaderProgram({ proceduralBladesVertexShader, bladesFragmentShader },
+			"PROCEDURAL BLADES SHADER");
+		proceduralTessellatedBladesVertexShader = new Shader("assets/shaders/blades_tess.vert", GL_VERTEX_SHADER,
+			proceduralDefines);
+		proceduralTessellatedBladesShaderProgram = new ShaderProgram({ proceduralTessellatedBladesVertexShader,
+			tessellatedBladesControlShader, tessellatedBladesEvaluationShader, bladesFragmentShader },
+			"PROCEDURAL TESSELLATED BLADES SHADER");
+
+		patchVertexShader = new Shader("assets/shaders/patch.vert", GL_VERTEX_SHADER, multiDrawDefines);
 		patchFragmentShader = new Shader("assets/shaders/patch.frag", GL_FRAGMENT_SHADER);
 
 		patchShaderProgram = new ShaderProgram({ patchVertexShader, patchFragmentShader }, "PATCH SHADER");
 
-		g_scene->config.perlinConfig.texture = new Texture("Perlin Noise", GL_TEXTURE_2D);
-		g_scene->config.perlinConfig.texture->loadTextureSingleChannel(PERLIN_NOISE_TEXTURE_WIDTH);
+		particlesVertexShader = new Shader("assets/shaders/particles.vert", GL_VERTEX_SHADER);
+		particlesFragmentShader = new Shader("assets/shaders/particles.frag", GL_FRAGMENT_SHADER);
+
+		particlesShaderProgram = new ShaderProgram({ particlesVertexShader, particlesFragmentShader }, "PARTICLES SHADER");
+
+		windTextureCache = new WindTextureCache(WIND_TEXTURE_CACHE_BYTES);
+		windTexturePipeline = new WindTexturePipeline();
+		streamingNoise = new StreamingNoise(PERLIN_NOISE_TEXTURE_WIDTH);
 
 		perlinNoiseComputeShader = new Shader("assets/shaders/perlin_noise.comp", GL_COMPUTE_SHADER);
 		perlinNoiseComputeShaderProgram = new ShaderProgram({ perlinNoiseComputeShader }, "PERLIN NOISE COMPUTE SHADER");
-
-		g_scene->config.checkerPatternTexture = new Texture("Checker Pattern", GL_TEXTURE_2D);
-		g_scene->config.checkerPatternTexture->loadTextureSingleChannel(CHECKER_PATTERN_TEXTURE_WIDTH);
+		noiseGpuTimer = new GpuTimer();
 
 		checkerPatternComputeShader = new Shader("assets/shaders/checker_pattern.comp", GL_COMPUTE_SHADER);
 		checkerPatternComputeShaderProgram = new ShaderProgram({ checkerPatternComputeShader }, "CHECKER PATTERN COMPUTE SHADER");
@@ -331,17 +575,15 @@ namespace GrassSimulation {
 		int width = PERLIN_NOISE_TEXTURE_WIDTH;
 		int height = PERLIN_NOISE_TEXTURE_WIDTH;
 
-		// Should this not be set to random?
-		perlinNoiseSeedTextureData = new float[width * height];
-		perlinNoiseSeedTexture = new Texture("Perlin Seed Texture", GL_TEXTURE_2D);
-		perlinNoiseSeedTexture->generateTexture(perlinNoiseSeedTextureData, width, height, GL_RED);
+		perlinNoiseTextureData = new float[width * height];
+		perlinNoiseSeedData = new float[width * height];
 
 		// Set up the z-buffer
 		glDepthRange(-1, 1); // Make the NDC a right handed coordinate system, 
 		// with the camera pointing towards -z
-		glEnable(GL_DEPTH_TEST); // Turn on z-buffer depth perlinNoiseTexture
+		GLState::enable(GL_DEPTH_TEST); // Turn on z-buffer depth perlinNoiseTexture
 		glDepthFunc(GL_LESS);    // Draws fragments that are closer to the screen in NDC
-		glEnable(GL_MULTISAMPLE);
+		GLState::enable(GL_MULTISAMPLE);
 	}
 
 	void initSceneObjects(Patch& patch)
@@ -361,33 +603,71 @@ namespace GrassSimulation {
 			patch.initOneDirectionBladeMatrices(g_scene->config.patchSize);
 		}
 
-		createInstanceMatrixBuffer(patch.getBladeMatrices(), MAX_BLADES_PER_PATCH);
-
-		for (int i = 0; i < MAX_PATCHES; i++)
-		{
-			// Position of the entire thing
-			glm::vec2 position = calculateSpiralPosition(i) * g_scene->config.patchSize;
-			SceneObjectIndexed* patchSceneObject = new SceneObjectIndexed(
-				grassPatchPositions, grassPatchColors, grassPatchIndices, grassPatchNormals, *patchShaderProgram);
-			glm::mat4 translation = glm::translate(position.x, 0, position.y);
-			// Set the patch object
-			patchSceneObject->model = translation * glm::scale(g_scene->config.patchSize, g_scene->config.patchSize, g_scene->config.patchSize);
-			g_scene->patches.push_back(patchSceneObject);
-
-			// Set the blades on the patch
-			SceneObjectInstanced* blades = new SceneObjectInstanced(
-				grassPositions, grassColors, grassIndices, grassNormals, instanceMatrixBuffer, *bladesShaderProgram, &grassUVs);
-			// Do not scale the blades
-			blades->model = translation * glm::scale(1, g_scene->config.bladeHeight, 1);
-			g_scene->blades.push_back(blades);
-		}
+		createBladeInstanceBuffer(patch.getBladeInstances(), MAX_BLADES_PER_PATCH);
+
+		// All visible patches, and all blades on them, are drawn with one call
+		// each
+		g_scene->patchField = new PatchField();
+		g_scene->patches = new SceneObjectMultiDraw(
+			grassPatchPositions, grassPatchColors, grassPatchIndices, grassPatchNormals, *patchShaderProgram);
+		g_scene->blades = new SceneObjectMultiDraw(
+			grassPositions, grassColors, grassIndices, grassNormals, *bladesShaderProgram, &grassUVs,
+			bladeInstanceBuffer, &BLADE_INSTANCE_LAYOUT);
+		g_scene->blades->instanceCount = -1;
+		g_scene->tessellatedBlades = new SceneObjectMultiDraw(
+			bladeControlPointPositions, bladeControlPointColors, bladeControlPointIndices, bladeControlPointNormals,
+			*tessellatedBladesShaderProgram, nullptr, bladeInstanceBuffer, &BLADE_INSTANCE_LAYOUT);
+		g_scene->tessellatedBlades->instanceCount = -1;
+		g_scene->tessellatedBlades->primitiveMode = GL_PATCHES;
+		// No instance buffer, the shaders place the blades
+		g_scene->proceduralBlades = new SceneObjectMultiDraw(
+			grassPositions, grassColors, grassIndices, grassNormals, *proceduralBladesShaderProgram, &grassUVs);
+		g_scene->proceduralBlades->instanceCount = -1;
+		g_scene->proceduralTessellatedBlades = new SceneObjectMultiDraw(
+			bladeControlPointPositions, bladeControlPointColors, bladeControlPointIndices, bladeControlPointNormals,
+			*proceduralTessellatedBladesShaderProgram);
+		g_scene->proceduralTessellatedBlades->instanceCount = -1;
+		g_scene->proceduralTessellatedBlades->primitiveMode = GL_PATCHES;
+		updatePatchModels();
+		g_scene->bladeCuller = new BladeCuller(*g_scene->blades, bladeInstanceBuffer, *bladesShaderProgram);
+		g_scene->bladeCuller->setTessellatedBlades(*g_scene->tessellatedBlades, *tessellatedBladesShaderProgram);
+		g_scene->impostorCards = new ImpostorCards();
 
 		SceneObjectArrays* fanDebugIcon = new SceneObjectArrays(fanDebugIconVertexPositions, *g_scene->lightShaderProgram);
 		g_scene->fanDebugIcon = fanDebugIcon;
+
+		particleSystem = new ParticleSystem(MAX_PARTICLES, *particlesShaderProgram);
+		g_scene->addSceneObject(particleSystem->getSceneObject());
 	}
 	void generateCheckerPatternTexture()
 	{
-		checkerPattern2DGPU(checkerPatternComputeShaderProgram, g_scene->config.checkerPatternTexture->getTextureID(), g_scene->config.checkerSize);
+		WindTextureKey key;
+		key.generator = WindTextureGenerator::CHECKER_PATTERN;
+		key.checkerSize = g_scene->config.checkerSize;
+		key.size = CHECKER_PATTERN_TEXTURE_WIDTH;
+
+		Texture* texture = windTextureCache->find(key);
+		if (texture)
+		{
+			useCachedWindTexture(&g_scene->config.checkerPatternTexture, texture);
+		}
+		else
+		{
+			texture = windTextureCache->insert(key, getWindTexturesInUse());
+			checkerPattern2DGPU(checkerPatternComputeShaderProgram, texture->getTextureID(), g_scene->config.checkerSize);
+			windTexturePipeline->submit(&g_scene->config.checkerPatternTexture, texture);
+		}
+		setWindTexturesForSimulationMode();
+	}
+
+	void useCachedWindTexture(Texture** target, Texture* texture)
+	{
+		// Still being generated, it is swapped in when done
+		if (windTexturePipeline->isPending(texture))
+			return;
+
+		windTexturePipeline->cancel(target);
+		*target = texture;
 	}
 
 	void checkerPattern2DGPU(ShaderProgram* computeShaderProgram, GLuint computeShaderTexture, int checkerSize)
@@ -400,27 +680,168 @@ namespace GrassSimulation {
 
 		GLCall(glDispatchCompute(CHECKER_PATTERN_TEXTURE_WIDTH / 16, CHECKER_PATTERN_TEXTURE_WIDTH / 16, 1));
 	}
+	ShaderProgram* getGradientNoiseComputeShaderProgram(int octaves)
+	{
+		int index = octaves - 1;
+		if (!gradientNoiseComputeShaderPrograms[index])
+		{
+			gradientNoiseComputeShaderPrograms[index] =
+				createGradientNoiseComputeShaderProgram(octaves, &gradientNoiseComputeShaders[index]);
+		}
+		return gradientNoiseComputeShaderPrograms[index];
+	}
+
+	void generateGradientNoiseTexture(Texture* texture)
+	{
+		auto& perlinConfig = g_scene->config.perlinConfig;
+
+		GradientNoiseSettings settings;
+		settings.octaves = perlinConfig.octaves;
+		settings.bias = perlinConfig.bias;
+		settings.seed = perlinConfig.seed;
+		settings.pitch = PERLIN_NOISE_TEXTURE_WIDTH;
+		settings.period = PERLIN_NOISE_TEXTURE_WIDTH;
+
+		if (perlinConfig.generateOnCPU)
+		{
+			gradientNoise2DCPU(settings, 0, 0, PERLIN_NOISE_TEXTURE_WIDTH, PERLIN_NOISE_TEXTURE_WIDTH,
+				perlinNoiseTextureData, threadPool);
+			texture->loadTextureSingleChannel(PERLIN_NOISE_TEXTURE_WIDTH, perlinNoiseTextureData);
+		}
+		else
+		{
+			ShaderProgram* program = getGradientNoiseComputeShaderProgram(gradientNoiseOctaves(settings));
+			noiseGpuTimer->begin();
+			gradientNoise2DGPU(settings, 0, 0, PERLIN_NOISE_TEXTURE_WIDTH, PERLIN_NOISE_TEXTURE_WIDTH,
+				program, texture->getTextureID());
+			noiseGpuTimer->end();
+		}
+	}
+
 	void generatePerlinNoiseTexture()
 	{
-		using namespace std::chrono;
-		// Initialize seed data
-		for (int i = 0; i < PERLIN_NOISE_TEXTURE_WIDTH * PERLIN_NOISE_TEXTURE_WIDTH; i++)
-			perlinNoiseSeedTextureData[i] = (float)rand() / (float)RAND_MAX;
-
-		perlinNoise2DGPU(*perlinNoiseSeedTexture, perlinNoiseSeedTextureData, perlinNoiseComputeShaderProgram,
-			g_scene->config.perlinConfig.texture->getTextureID(), g_scene->config.perlinConfig.octaves,
-			g_scene->config.perlinConfig.bias);
+		auto& perlinConfig = g_scene->config.perlinConfig;
+
+		WindTextureKey key;
+		key.generator = perlinConfig.generator == NoiseGenerator::GRADIENT_NOISE ?
+			WindTextureGenerator::GRADIENT_NOISE : WindTextureGenerator::VALUE_NOISE;
+		key.octaves = perlinConfig.octaves;
+		key.bias = perlinConfig.bias;
+		key.seed = perlinConfig.seed;
+		key.size = PERLIN_NOISE_TEXTURE_WIDTH;
+
+		Texture* texture = windTextureCache->find(key);
+		if (texture)
+		{
+			useCachedWindTexture(&perlinConfig.texture, texture);
+		}
+		else
+		{
+			texture = windTextureCache->insert(key, getWindTexturesInUse());
+			if (perlinConfig.generator == NoiseGenerator::GRADIENT_NOISE)
+			{
+				generateGradientNoiseTexture(texture);
+			}
+			else
+			{
+				generateValueNoiseTexture(texture);
+			}
+			windTexturePipeline->submit(&perlinConfig.texture, texture);
+		}
+		setWindTexturesForSimulationMode();
+	}
+
+	void generateValueNoiseTexture(Texture* texture)
+	{
+		if (g_scene->config.perlinConfig.generateOnCPU)
+		{
+			perlinNoiseSeeds(PERLIN_NOISE_TEXTURE_WIDTH, g_scene->config.perlinConfig.seed, perlinNoiseSeedData);
+			perlinNoise2DCPU(PERLIN_NOISE_TEXTURE_WIDTH, PERLIN_NOISE_TEXTURE_WIDTH, g_scene->config.perlinConfig.octaves,
+				g_scene->config.perlinConfig.bias, perlinNoiseTextureData, perlinNoiseSeedData, threadPool);
+			texture->loadTextureSingleChannel(PERLIN_NOISE_TEXTURE_WIDTH, perlinNoiseTextureData);
+		}
+		else
+		{
+			noiseGpuTimer->begin();
+			perlinNoise2DGPU(perlinNoiseComputeShaderProgram, texture->getTextureID(),
+				g_scene->config.perlinConfig.octaves, g_scene->config.perlinConfig.bias, g_scene->config.perlinConfig.seed);
+			noiseGpuTimer->end();
+		}
+	}
+	void generateDensityMap()
+	{
+		auto& densityMapConfig = g_scene->config.densityMapConfig;
+		if (!densityMapConfig.texture)
+			densityMapConfig.texture = new Texture("Density Map", GL_TEXTURE_2D);
+		densityMapConfig.texture->loadTextureSingleChannel(PERLIN_NOISE_TEXTURE_WIDTH);
+		densityMapConfig.texture->setFilter(GL_LINEAR);
+
+		// Patches of grass a few patches wide, with clearings in between
+		GradientNoiseSettings settings;
+		settings.octaves = 4;
+		settings.seed = densityMapConfig.seed;
+		settings.pitch = PERLIN_NOISE_TEXTURE_WIDTH / 4;
+		settings.period = PERLIN_NOISE_TEXTURE_WIDTH;
+
+		if (g_scene->config.perlinConfig.generateOnCPU)
+		{
+			gradientNoise2DCPU(settings, 0, 0, PERLIN_NOISE_TEXTURE_WIDTH, PERLIN_NOISE_TEXTURE_WIDTH,
+				perlinNoiseTextureData, threadPool);
+			densityMapConfig.texture->loadTextureSingleChannel(PERLIN_NOISE_TEXTURE_WIDTH, perlinNoiseTextureData);
+			densityMapConfig.texture->setFilter(GL_LINEAR);
+		}
+		else
+		{
+			ShaderProgram* program = getGradientNoiseComputeShaderProgram(gradientNoiseOctaves(settings));
+			gradientNoise2DGPU(settings, 0, 0, PERLIN_NOISE_TEXTURE_WIDTH, PERLIN_NOISE_TEXTURE_WIDTH,
+				program, densityMapConfig.texture->getTextureID());
+			// The blade pass samples it
+			GLCall(glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT));
+		}
 	}
+
+	void loadDensityMap()
+	{
+		auto& densityMapConfig = g_scene->config.densityMapConfig;
+		if (!std::filesystem::exists(densityMapPath))
+		{
+			LOG_WARNING("Density map '%s' does not exist", densityMapPath);
+			return;
+		}
+
+		if (!densityMapConfig.texture)
+			densityMapConfig.texture = new Texture("Density Map", GL_TEXTURE_2D);
+		densityMapConfig.texture->loadTexture(densityMapPath);
+	}
+
+	std::vector<const Texture*> getWindTexturesInUse()
+	{
+		std::vector<const Texture*> textures = { g_scene->config.perlinConfig.texture, g_scene->config.checkerPatternTexture };
+		windTexturePipeline->getPendingTextures(textures);
+		return textures;
+	}
+
+	void drawWindTextureCacheStats()
+	{
+		ImGui::Text("Texture cache: %d textures, %.2f / %.2f MB, %d hits, %d misses",
+			(int)windTextureCache->getTextureCount(),
+			windTextureCache->getUsedBytes() / (1024.0f * 1024.0f),
+			windTextureCache->getMaxBytes() / (1024.0f * 1024.0f),
+			windTextureCache->getHits(), windTextureCache->getMisses());
+	}
+
 	void setWindTexturesForSimulationMode()
 	{
-		if (g_scene->config.simulationMode == SimulationMode::FLUID_GRID)
+		if (g_scene->config.simulationMode == SimulationMode::FLUID_GRID ||
+			g_scene->config.simulationMode == SimulationMode::FLUID_FLIPBOOK)
 		{
 			g_scene->config.windX = g_scene->config.fluidGridConfig.velX;
 			g_scene->config.windY = g_scene->config.fluidGridConfig.velY;
 		}
 		else if (g_scene->config.simulationMode == SimulationMode::PERLIN_NOISE)
 		{
-			g_scene->config.windX = g_scene->config.perlinConfig.texture;
+			g_scene->config.windX = g_scene->config.perlinConfig.streaming ?
+				streamingNoise->getTexture() : g_scene->config.perlinConfig.texture;
 			g_scene->config.windY = nullptr;
 		}
 		else if (g_scene->config.simulationMode == SimulationMode::CHECKER_PATTERN)
@@ -432,32 +853,66 @@ namespace GrassSimulation {
 	}
 
 
-	void createInstanceMatrixBuffer(glm::mat4* modelMatrices, const unsigned int numInstances)
+	void createBladeInstanceBuffer(BladeInstance* bladeInstances, const unsigned int numInstances)
+	{
+		GLCall(glGenBuffers(1, &bladeInstanceBuffer));
+		transferBladeInstanceBuffer(bladeInstances, numInstances);
+	}
+
+	void transferBladeInstanceBuffer(BladeInstance* bladeInstances, const unsigned int numInstances)
 	{
-		GLCall(glGenBuffers(1, &instanceMatrixBuffer));
-		transferInstanceMatrixBuffer(modelMatrices, numInstances);
+		GLState::bindBuffer(GL_ARRAY_BUFFER, bladeInstanceBuffer);
+		GLCall(glBufferData(GL_ARRAY_BUFFER, numInstances * sizeof(BladeInstance), bladeInstances, GL_STATIC_DRAW));
+		GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+		bakeImpostorCards();
 	}
 
-	void transferInstanceMatrixBuffer(glm::mat4* modelMatrices, const unsigned int numInstances)
+	void bakeImpostorCards()
 	{
-		GLCall(glBindBuffer(GL_ARRAY_BUFFER, instanceMatrixBuffer));
-		GLCall(glBufferData(GL_ARRAY_BUFFER, numInstances * sizeof(glm::mat4), modelMatrices, GL_STATIC_DRAW));
-		GLCall(glBindBuffer(GL_ARRAY_BUFFER, 0));
+		// Not created yet while the first blades are transferred
+		if (!g_scene->impostorCards)
+			return;
+
+		// The bake copies the instance buffer, even for procedural blades
+		auto& config = g_scene->config;
+		int bladeCount = glm::clamp(config.numBladesPerPatch, 0, MAX_BLADES_PER_PATCH);
+		g_scene->impostorCards->bake(bladeInstanceBuffer, bladeCount, config.patchSize);
+	}
+
+	void updatePatchModels()
+	{
+		auto& config = g_scene->config;
+		std::vector<glm::vec2> positions(config.numPatches);
+		for (int i = 0; i < config.numPatches; i++)
+		{
+			// Position of the entire thing
+			positions[i] = calculateSpiralPosition(i) * config.patchSize;
+		}
+		g_scene->patchField->build(positions, config.patchSize, config.bladeHeight);
+		setWorldMinMax();
 	}
 
 	void setWorldMinMax()
 	{
+		// At least one patch, so the world never collapses
+		int numPatches = glm::max(g_scene->config.numPatches, 1);
+
 		/* Since we're making a spiral pattern, we can find the leftmost edge by taking the sqrt, giving us the width.
 			 Dividing that in two, so we have what would be to either side, taking the floor of that, since we know we
 			 start at (0, 0), so the left will have fewer patches for odd widths. We then negate it, because it's in the
 			 negative halfspace.
 		 */
-		g_scene->config.worldMin = (float)(-floor(sqrt(MAX_PATCHES) / 2) * (double)g_scene->config.patchSize);
+		g_scene->config.worldMin = (float)(-floor(sqrt(numPatches) / 2) * (double)g_scene->config.patchSize);
 
 		/* The process for the max is similar, though we take the ceiling rather than the floor. Because since we start at (0, 0) there are more
 			 patches to the right.
 		 */
-		g_scene->config.worldMax = (float)(ceil(sqrt(MAX_PATCHES) / 2) * (double)g_scene->config.patchSize);
+		g_scene->config.worldMax = (float)(ceil(sqrt(numPatches) / 2) * (double)g_scene->config.patchSize);
+
+		float worldWidth = g_scene->config.worldMax - g_scene->config.worldMin;
+		float center = (g_scene->config.worldMax + g_scene->config.worldMin) / 2.0f;
+		g_scene->worldRekt.center = { center, 0.0f, center };
+		g_scene->worldRekt.height = g_scene->worldRekt.width = worldWidth;
 	}
 
 
@@ -470,20 +925,7 @@ namespace GrassSimulation {
 		}
 
 		// FAN!
-		for (size_t fanIndex = 0; fanIndex < g_scene->config.fluidGridConfig.fans.size(); fanIndex++)
-		{
-			Fan& fan = g_scene->config.fluidGridConfig.fans[fanIndex];
-			if (!fan.active)
-			{
-				continue;
-			}
-
-			int x = (int)(fluidGrid->getN() * fan.position.x);
-			int y = (int)(fluidGrid->getN() * fan.position.y);
-
-			fluidGrid->addVelocityAt(x, y, fan.velocity.x, -fan.velocity.y);
-			fluidGrid->addDensityAt(x, y, fan.density);
-		}
+		fluidGrid->applyFans(g_scene->config.fluidGridConfig.fans);
 
 		clearNextSimulate = true;
 
@@ -498,10 +940,38 @@ namespace GrassSimulation {
 		return g_scene->config.numPatches > 0 && g_scene->config.numBladesPerPatch > 0;
 	}
 
+	void updateParticles(float deltaTime)
+	{
+		// Particles follow the fluid grid, the other modes have no velocities
+		auto& config = g_scene->config;
+		bool windIsFluid = config.simulationMode == SimulationMode::FLUID_GRID ||
+			config.simulationMode == SimulationMode::FLUID_FLIPBOOK;
+
+		particleSystem->getSceneObject()->isVisible = config.particleConfig.enabled && windIsFluid;
+
+		if (particleSystem->getSceneObject()->isVisible && !config.isPaused)
+		{
+			particleSystem->update(deltaTime, *g_scene, *threadPool);
+		}
+	}
+
 	bool setup(Scene* scene)
 	{
 		g_scene = scene;
+		threadPool = new ThreadPool();
 		fluidGrid = new FluidGrid(128, 0, 0, &g_scene->config.fluidGridConfig);
+		g_scene->config.fluidGridConfig.fluidGrid = fluidGrid;
+
+		if (scene->config.numPatches < 0)
+		{
+			scene->config.numPatches = DEFAULT_PATCHES;
+		}
+		if (scene->config.numPatches > MAX_PATCHES)
+		{
+			LOG_WARNING("Num patches should be between 0 and %d but was %d. Clamping.",
+				MAX_PATCHES, scene->config.numPatches);
+			scene->config.numPatches = glm::clamp(scene->config.numPatches, 0, MAX_PATCHES);
+		}
 
 		initShadersAndTextures();
 		initSceneObjects(patchTemplate);
@@ -514,12 +984,6 @@ namespace GrassSimulation {
 		{
 			generatePerlinNoiseTexture();
 		}
-		setWorldMinMax();
-
-		float worldWidth = scene->config.worldMax - scene->config.worldMin;
-		float center = (scene->config.worldMax + scene->config.worldMin) / 2.0f;
-		scene->worldRekt.center = { center, 0.0f, center };
-		scene->worldRekt.height = scene->worldRekt.width = worldWidth;
 
 		Fan fan{};
 		fan.active = true;
@@ -532,39 +996,91 @@ namespace GrassSimulation {
 
 		scene->config.fluidGridConfig.fans.push_back(fan);
 
+		// Start with warmed up wind, if it was saved before
+		if (std::filesystem::exists(fluidGridSnapshotPath))
+		{
+			fluidGrid->loadState(fluidGridSnapshotPath);
+		}
+
 		// Set num blades per patch
 		if (scene->config.numBladesPerPatch < 0)
 		{
 			scene->config.numBladesPerPatch = MAX_BLADES_PER_PATCH;
 		}
 
-		if (scene->config.numBladesPerPatch > MAX_BLADES_PER_PATCH)
+		int maxBlades = maxBladesPerPatch(scene->config);
+		if (scene->config.numBladesPerPatch > maxBlades)
 		{
 			LOG_WARNING("Num blades per patch should be between 0 and %d but was %d. Clamping.",
-				MAX_BLADES_PER_PATCH,
+				maxBlades,
 				scene->config.numBladesPerPatch);
-			scene->config.numBladesPerPatch = glm::clamp(scene->config.numBladesPerPatch, 0, MAX_BLADES_PER_PATCH);
+			scene->config.numBladesPerPatch = glm::clamp(scene->config.numBladesPerPatch, 0, maxBlades);
 		}
 
-		if (scene->config.numPatches < 0)
+		// Needs the number of blades
+		bakeImpostorCards();
+
+		return true;
+	}
+
+	void updateWindOffset()
+	{
+		auto& config = g_scene->config;
+		if (glm::length(config.windDirection) > 0.0f)
 		{
-			scene->config.numPatches = MAX_PATCHES;
+			config.windOffset = config.currentTime * config.windStrength * glm::normalize(config.windDirection);
 		}
-		if (scene->config.numPatches > MAX_PATCHES)
+	}
+
+	void updateStreamingNoise()
+	{
+		auto& perlinConfig = g_scene->config.perlinConfig;
+		if (g_scene->config.simulationMode != SimulationMode::PERLIN_NOISE || !perlinConfig.streaming)
+			return;
+
+		// Streams gradient noise whichever generator is selected, value noise
+		// can not be generated for a window
+		GradientNoiseSettings settings;
+		settings.octaves = perlinConfig.octaves;
+		settings.bias = perlinConfig.bias;
+		settings.seed = perlinConfig.seed;
+		settings.pitch = PERLIN_NOISE_TEXTURE_WIDTH;
+		streamingNoise->setSettings(settings);
+
+		if (perlinConfig.generateOnCPU)
 		{
-			LOG_WARNING("Num patches should be between 0 and %d but was %d. Clamping.",
-				MAX_PATCHES, scene->config.numPatches);
-			scene->config.numPatches = glm::clamp(scene->config.numPatches, 0, MAX_PATCHES);
+			streamingNoise->update(g_scene->config.windOffset, nullptr, threadPool);
+		}
+		else
+		{
+			ShaderProgram* program = getGradientNoiseComputeShaderProgram(gradientNoiseOctaves(settings));
+			noiseGpuTimer->begin();
+			streamingNoise->update(g_scene->config.windOffset, program, threadPool);
+			noiseGpuTimer->end();
 		}
-
-		return true;
 	}
 
 	bool update(float deltaTime)
 	{
+		if (windTexturePipeline->poll())
+		{
+			setWindTexturesForSimulationMode();
+		}
+		updateWindOffset();
+		updateStreamingNoise();
+
 		if (shouldSimulateGrass())
 		{
-			simulateGrass(deltaTime);
+			if (g_scene->config.simulationMode == SimulationMode::FLUID_FLIPBOOK)
+			{
+				windFlipbook.play(deltaTime, *fluidGrid);
+			}
+			else
+			{
+				simulateGrass(deltaTime);
+			}
+
+			updateParticles(deltaTime);
 
 			glm::vec2 mousePos = inputs.getNormalizedMousePosition();
 			Ray mouseRay = getMouseRay();
@@ -589,7 +1105,21 @@ namespace GrassSimulation {
 
 	void reloadShaders() {
 		bladesShaderProgram->reloadShaders();
+		tessellatedBladesShaderProgram->reloadShaders();
+		proceduralBladesShaderProgram->reloadShaders();
+		proceduralTessellatedBladesShaderProgram->reloadShaders();
 		patchShaderProgram->reloadShaders();
+		particlesShaderProgram->reloadShaders();
+		perlinNoiseComputeShaderProgram->reloadShaders();
+		if (g_scene->bladeCuller)
+			g_scene->bladeCuller->reloadShaders();
+		if (g_scene->impostorCards)
+			g_scene->impostorCards->reloadShaders();
+		for (ShaderProgram* program : gradientNoiseComputeShaderPrograms)
+		{
+			if (program)
+				program->reloadShaders();
+		}
 	}
 
 	void cleanup()
@@ -597,9 +1127,53 @@ namespace GrassSimulation {
 		delete bladesVertexShader;
 		delete bladesFragmentShader;
 		delete bladesShaderProgram;
+		delete tessellatedBladesVertexShader;
+		delete tessellatedBladesControlShader;
+		delete tessellatedBladesEvaluationShader;
+		delete tessellatedBladesShaderProgram;
+		delete proceduralBladesVertexShader;
+		delete proceduralBladesShaderProgram;
+		delete proceduralTessellatedBladesVertexShader;
+		delete proceduralTessellatedBladesShaderProgram;
 		delete patchVertexShader;
 		delete patchFragmentShader;
 		delete patchShaderProgram;
+		delete g_scene->bladeCuller;
+		delete g_scene->impostorCards;
+		delete g_scene->patchField;
+		delete g_scene->patches;
+		delete g_scene->blades;
+		delete g_scene->tessellatedBlades;
+		delete g_scene->proceduralBlades;
+		delete g_scene->proceduralTessellatedBlades;
+		g_scene->bladeCuller = nullptr;
+		g_scene->impostorCards = nullptr;
+		g_scene->patchField = nullptr;
+		g_scene->patches = nullptr;
+		g_scene->blades = nullptr;
+		g_scene->tessellatedBlades = nullptr;
+		g_scene->proceduralBlades = nullptr;
+		g_scene->proceduralTessellatedBlades = nullptr;
+		delete particleSystem;
+		delete particlesVertexShader;
+		delete particlesFragmentShader;
+		delete particlesShaderProgram;
+		delete threadPool;
+		delete noiseGpuTimer;
+		delete perlinNoiseComputeShader;
+		delete perlinNoiseComputeShaderProgram;
+		delete[] perlinNoiseTextureData;
+		delete[] perlinNoiseSeedData;
+		delete g_scene->config.densityMapConfig.texture;
+		g_scene->config.densityMapConfig.texture = nullptr;
+		delete windTexturePipeline;
+		delete windTextureCache;
+		delete streamingNoise;
+		for (int i = 0; i < MAX_GRADIENT_NOISE_OCTAVES; i++)
+		{
+			delete gradientNoiseComputeShaderPrograms[i];
+			delete gradientNoiseComputeShaders[i];
+		}
 	}
 
 	void drawFluidGridWindow()
@@ -720,6 +1294,43 @@ namespace GrassSimulation {
 				fluidGrid->initialize();
 			}
 
+			ImGui::InputText("Snapshot Path", fluidGridSnapshotPath, sizeof(fluidGridSnapshotPath));
+			if (ImGui::Button("Save Snapshot"))
+			{
+				fluidGrid->saveState(fluidGridSnapshotPath);
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Load Snapshot"))
+			{
+				fluidGrid->loadState(fluidGridSnapshotPath);
+			}
+			drawTooltip("Saves or restores the whole simulation, including the fans. Restored on startup.");
+
+			if (static bool publishWindField = false;
+				ImGui::Checkbox("Publish Wind Field", &publishWindField))
+			{
+				if (publishWindField)
+				{
+					fluidGrid->setPublisher(&windFieldPublisher);
+				}
+				else
+				{
+					fluidGrid->setPublisher(nullptr);
+					windFieldPublisher.close();
+				}
+			}
+			drawTooltip("Shares every frame of the wind field with other processes through shared memory. See wind_field_reader.");
+			if (windFieldPublisher.isOpen())
+			{
+				ImGui::SameLine();
+				ImGui::Text("Frame %llu", (unsigned long long)windFieldPublisher.getFrameId());
+			}
+
+			if (ImGui::CollapsingHeader("Bake Flipbook"))
+			{
+				drawFlipbookBakeSettings();
+			}
+
 
 
 			if (static float diffRatio = 0.56f;
@@ -737,6 +1348,95 @@ namespace GrassSimulation {
 	}
 
 
+	void drawFlipbookBakeSettings()
+	{
+		static WindFlipbookBakeSettings bakeSettings;
+
+		ImGui::InputText("Flipbook Path", windFlipbookPath, sizeof(windFlipbookPath));
+		ImGui::DragFloat("Warmup Seconds", &bakeSettings.warmupSeconds, 0.1f, 0.0f, 60.0f);
+		drawTooltip("Simulated before recording, so the wind has settled.");
+		ImGui::DragFloat("Loop Seconds", &bakeSettings.seconds, 0.1f, 0.1f, 120.0f);
+		ImGui::DragFloat("Crossfade Seconds", &bakeSettings.crossfadeSeconds, 0.1f, 0.0f, bakeSettings.seconds);
+		drawTooltip("Time faded from the end into the start, hiding the seam of the loop.");
+		ImGui::SliderInt("Frames Per Second", &bakeSettings.framesPerSecond, 1, 120);
+
+		if (ImGui::Button("Bake"))
+		{
+			// Bake the wind as it is set up now
+			bakeSettings.N = fluidGrid->getN();
+			bakeSettings.diffusion = *fluidGrid->getDiffPointer();
+			bakeSettings.viscosity = *fluidGrid->getViscPointer();
+
+			auto startTime = glfwGetTime();
+			if (WindFlipbook::bake(windFlipbookPath, bakeSettings, g_scene->config.fluidGridConfig.fans))
+			{
+				LOG_INFO("Baking the flipbook took %.2fms", (glfwGetTime() - startTime) * 1000);
+			}
+		}
+	}
+
+	void drawFlipbookPlaybackSettings()
+	{
+		ImGui::InputText("Flipbook Path", windFlipbookPath, sizeof(windFlipbookPath));
+		if (ImGui::Button("Open Flipbook"))
+		{
+			windFlipbook.open(windFlipbookPath);
+		}
+
+		if (windFlipbook.isOpen())
+		{
+			ImGui::Text("%d frames of %dx%d at %.0f FPS", windFlipbook.getFrameCount(),
+				windFlipbook.getResolution(), windFlipbook.getResolution(), windFlipbook.getFramesPerSecond());
+		}
+		else
+		{
+			ImGui::Text("No flipbook opened. Bake one in Fluid Grid mode.");
+		}
+
+		ImGui::SliderFloat("Playback Speed", &windFlipbook.playbackSpeed, -2.0f, 2.0f);
+		ImGui::DragFloat("Velocity Multiplier", &g_scene->config.fluidGridConfig.velocityMultiplier, 0.1f, 0, 100.0f);
+		ImGui::DragFloat2("Velocity Clamp", (float*)&g_scene->config.fluidGridConfig.velocityClampRange, 0.1f, 0, 2.0f);
+	}
+
+	void drawParticleSettings()
+	{
+		auto& particleConfig = g_scene->config.particleConfig;
+
+		ImGui::Checkbox("Particles", &particleConfig.enabled);
+		drawTooltip("Particles carried by the fluid grid wind.");
+
+		if (ImGui::RadioButton("Leaves", particleConfig.type == ParticleType::LEAVES))
+		{
+			applyParticleTypePreset(particleConfig, ParticleType::LEAVES);
+		}
+		ImGui::SameLine();
+		if (ImGui::RadioButton("Pollen", particleConfig.type == ParticleType::POLLEN))
+		{
+			applyParticleTypePreset(particleConfig, ParticleType::POLLEN);
+		}
+		ImGui::SameLine();
+		if (ImGui::RadioButton("Dust", particleConfig.type == ParticleType::DUST))
+		{
+			applyParticleTypePreset(particleConfig, ParticleType::DUST);
+		}
+
+		ImGui::SliderInt("Particle Count", &particleConfig.count, 0, particleSystem->getMaxParticles());
+		ImGui::SliderFloat("Particle Size", &particleConfig.size, 0.01f, 1.0f);
+		ImGui::ColorEdit3("Particle Color", (float*)&particleConfig.color);
+		ImGui::DragFloat("Wind Influence", &particleConfig.windInfluence, 0.01f, 0.0f, 10.0f);
+		drawTooltip("Multiplies the wind velocity the particles are carried with.");
+		ImGui::DragFloat("Wind Response", &particleConfig.windResponse, 0.05f, 0.0f, 50.0f);
+		drawTooltip("How quickly particles take on the wind velocity.");
+		ImGui::DragFloat("Fall Speed", &particleConfig.fallSpeed, 0.01f, 0.0f, 10.0f);
+		ImGui::DragFloat("Spawn Height", &particleConfig.spawnHeight, 0.1f, 0.0f, 50.0f);
+		ImGui::DragFloat2("Lifetime", (float*)&particleConfig.lifetimeRange, 0.1f, 0.1f, 60.0f);
+
+		if (particleConfig.enabled)
+		{
+			ImGui::Text("Update %.3fms on %u threads", particleSystem->getUpdateMilliseconds(), threadPool->getThreadCount());
+		}
+	}
+
 	void drawFanWindow()
 	{
 		auto& conf = g_scene->config;
@@ -826,9 +1526,6 @@ namespace GrassSimulation {
 		{
 			config.simulationMode = SimulationMode::PERLIN_NOISE;
 			generatePerlinNoiseTexture();
-
-			config.windX = config.perlinConfig.texture;
-			config.windY = nullptr;
 		}
 		ImGui::SameLine();
 		drawTooltip("Blades respond to the generated perlin noise.");
@@ -836,9 +1533,6 @@ namespace GrassSimulation {
 		{
 			config.simulationMode = SimulationMode::CHECKER_PATTERN;
 			generateCheckerPatternTexture();
-
-			config.windX = config.checkerPatternTexture;
-			config.windY = nullptr;
 		}
 		ImGui::SameLine();
 		drawTooltip("Blades respond to the generated checker pattern.");
@@ -849,6 +1543,17 @@ namespace GrassSimulation {
 			config.windY = config.fluidGridConfig.velY;
 		}
 		drawTooltip("Blades respond to the fluid grid simulation.");
+		if (ImGui::RadioButton("Fluid Flipbook", config.simulationMode == SimulationMode::FLUID_FLIPBOOK))
+		{
+			config.simulationMode = SimulationMode::FLUID_FLIPBOOK;
+			config.windX = config.fluidGridConfig.velX;
+			config.windY = config.fluidGridConfig.velY;
+			if (!windFlipbook.isOpen())
+			{
+				windFlipbook.open(windFlipbookPath);
+			}
+		}
+		drawTooltip("Blades respond to fluid grid wind baked to a file.");
 
 
 		ImGui::Text("Harry Styles Settings");
@@ -857,7 +1562,7 @@ namespace GrassSimulation {
 		{
 			config.bladeDistribution = BladeDistribution::HARRY_STYLES_WITH_RANDOS;
 			patchTemplate.initHarryEdwardStylesBladeMatrices(config.patchSize);
-			transferInstanceMatrixBuffer(patchTemplate.getBladeMatrices(), MAX_BLADES_PER_PATCH);
+			transferBladeInstanceBuffer(patchTemplate.getBladeInstances(), MAX_BLADES_PER_PATCH);
 		}
 		ImGui::SameLine();
 		drawTooltip("Blades are placed uniformly on the patch with random rotations.");
@@ -865,7 +1570,7 @@ namespace GrassSimulation {
 		{
 			config.bladeDistribution = BladeDistribution::HARRY_STYLES;
 			patchTemplate.initHarryEdwardStylesBladeMatrices(config.patchSize, false);
-			transferInstanceMatrixBuffer(patchTemplate.getBladeMatrices(), MAX_BLADES_PER_PATCH);
+			transferBladeInstanceBuffer(patchTemplate.getBladeInstances(), MAX_BLADES_PER_PATCH);
 		}
 		ImGui::SameLine();
 		drawTooltip("Blades are placed uniformly on the patch without random rotations.");
@@ -873,9 +1578,26 @@ namespace GrassSimulation {
 		{
 			config.bladeDistribution = BladeDistribution::ONE_DIRECTION;
 			patchTemplate.initOneDirectionBladeMatrices(config.patchSize);
-			transferInstanceMatrixBuffer(patchTemplate.getBladeMatrices(), MAX_BLADES_PER_PATCH);
+			transferBladeInstanceBuffer(patchTemplate.getBladeInstances(), MAX_BLADES_PER_PATCH);
 		}
 		drawTooltip("Blades are placed in a line in the middle of the patch without random rotations.");
+		if (ImGui::Checkbox("Procedural Blades", &config.proceduralBlades) &&
+			config.numBladesPerPatch > maxBladesPerPatch(config))
+		{
+			config.numBladesPerPatch = maxBladesPerPatch(config);
+			bakeImpostorCards();
+		}
+		drawTooltip("Places the blades in the shaders, different on every patch, instead of copying one patch.");
+
+		ImGui::Checkbox("Tessellated Blades", &config.tessellationConfig.enabled);
+		drawTooltip("Draws every blade from a single point, curved by the tessellation stages.");
+		if (config.tessellationConfig.enabled)
+		{
+			ImGui::SliderInt("Max Tessellation Level", &config.tessellationConfig.maxLevel, 1, 32);
+			drawTooltip("Segments of the blades up close.");
+			ImGui::SliderFloat("Full Detail Distance", &config.tessellationConfig.fullDetailDistance, 1.0f, 200.0f);
+			drawTooltip("Blades closer than this get all the segments, further ones fewer, down to one triangle.");
+		}
 
 		ImGui::Checkbox("Debug Blades", &config.debugBlades);
 		ImGui::Checkbox("Visualize Texture On Patch", &config.visualizeTexture);
@@ -905,12 +1627,7 @@ namespace GrassSimulation {
 
 		if (ImGui::SliderFloat("Blade height", &config.bladeHeight, 0.1f, 10.0f))
 		{
-			for (int i = 0; i < MAX_PATCHES; i++)
-			{
-				glm::vec2 position = calculateSpiralPosition(i) * config.patchSize;
-				glm::mat4 translation = glm::translate(position.x, 0, position.y);
-				g_scene->blades[i]->model = translation * glm::scale(1, config.bladeHeight, 1);
-			}
+			updatePatchModels();
 		}
 
 		if (ImGui::SliderFloat("PatchSize", &config.patchSize, 1.0f, 100.0f))
@@ -928,29 +1645,90 @@ namespace GrassSimulation {
 				break;
 			}
 
-			transferInstanceMatrixBuffer(patchTemplate.getBladeMatrices(), MAX_BLADES_PER_PATCH);
-
-			for (int i = 0; i < MAX_PATCHES; i++)
-			{
-				glm::vec2 position = calculateSpiralPosition(i) * config.patchSize;
-				glm::mat4 translation = glm::translate(position.x, 0, position.y);
-				g_scene->patches[i]->model = translation * glm::scale(config.patchSize, config.patchSize, config.patchSize);
-				g_scene->blades[i]->model = translation * glm::scale(1, config.bladeHeight, 1);
-			}
+			transferBladeInstanceBuffer(patchTemplate.getBladeInstances(), MAX_BLADES_PER_PATCH);
 
-			setWorldMinMax();
+			updatePatchModels();
 		}
 
 
 		drawTooltip("The sizes of each individual Patch. Same number of blades of grass.");
 
-		ImGui::SliderInt("Number of patches", &config.numPatches, 0, MAX_PATCHES);
-		ImGui::DragInt("Number blades per patch", &config.numBladesPerPatch, 1, 0, MAX_BLADES_PER_PATCH);
-		config.numBladesPerPatch = glm::clamp(config.numBladesPerPatch, 0, (int)MAX_BLADES_PER_PATCH);
+		if (ImGui::SliderInt("Number of patches", &config.numPatches, 0, MAX_PATCHES, "%d", ImGuiSliderFlags_Logarithmic))
+		{
+			updatePatchModels();
+		}
+		if (ImGui::DragInt("Number blades per patch", &config.numBladesPerPatch, 1, 0, maxBladesPerPatch(config)))
+		{
+			config.numBladesPerPatch = glm::clamp(config.numBladesPerPatch, 0, maxBladesPerPatch(config));
+			bakeImpostorCards();
+		}
 		ImGui::SliderFloat("Sway Reach", &config.swayReach, 0.0f, 2.0f);
 		drawTooltip("How far the blades will move in the wind.");
 
-		if (config.simulationMode != SimulationMode::FLUID_GRID)
+		ImGui::Checkbox("GPU Blade Culling", &config.cullingConfig.enabled);
+		drawTooltip("Skips blades outside the view or further away than the cull distance, on the GPU.");
+		if (config.cullingConfig.enabled && g_scene->bladeCuller)
+		{
+			ImGui::SliderFloat("Cull Distance", &config.cullingConfig.maxDistance, 1.0f, 1000.0f);
+			ImGui::Text("Visible patches: %d / %d in %.3fms", g_scene->patchField->getVisiblePatches(),
+				g_scene->patchField->getPatchCount(), g_scene->patchField->getCullMilliseconds());
+			ImGui::Text("Visible blades: %d / %d", g_scene->bladeCuller->getVisibleBlades(), g_scene->bladeCuller->getTestedBlades());
+		}
+
+		ImGui::Checkbox("Blade Density LOD", &config.densityLodConfig.enabled);
+		drawTooltip("Draws fewer, wider blades on patches that are small on screen.");
+		if (config.densityLodConfig.enabled)
+		{
+			ImGui::SliderFloat("Full Density Pixels", &config.densityLodConfig.fullDensityPixels, 10.0f, 2000.0f, "%.0f",
+				ImGuiSliderFlags_Logarithmic);
+			drawTooltip("Patches at least this many pixels tall on screen draw all of their blades.");
+			ImGui::SliderFloat("Min Density", &config.densityLodConfig.minDensity, 0.01f, 1.0f);
+			drawTooltip("Fraction of the blades the furthest patches still draw.");
+			if (g_scene->patchField)
+				ImGui::Text("Drawn blades: %d", g_scene->patchField->getDrawnBlades());
+		}
+
+		ImGui::Checkbox("Impostor Cards", &config.impostorConfig.enabled);
+		drawTooltip("Draws the furthest patches as a few cards with blades painted on them.");
+		if (config.impostorConfig.enabled)
+		{
+			ImGui::SliderFloat("Impostor Distance", &config.impostorConfig.startDistance, 1.0f, 1000.0f);
+			drawTooltip("Patches further away than this are drawn as cards.");
+			if (g_scene->patchField)
+				ImGui::Text("Impostor patches: %d", g_scene->patchField->getImpostorPatches());
+		}
+
+		MeshRegistry& meshRegistry = MeshRegistry::instance();
+		ImGui::Text("Meshes: %d shared by %d objects, %.1f KB, %.1f KB not uploaded again",
+			(int)meshRegistry.getMeshCount(), meshRegistry.getReferenceCount(),
+			meshRegistry.getUploadedBytes() / 1024.0f, meshRegistry.getSharedBytes() / 1024.0f);
+
+		if (ImGui::Checkbox("Density Map", &config.densityMapConfig.enabled) &&
+			config.densityMapConfig.enabled && !config.densityMapConfig.texture)
+		{
+			generateDensityMap();
+		}
+		drawTooltip("Grows the blades where a density map says so, placed on the GPU.");
+		if (config.densityMapConfig.enabled)
+		{
+			ImGui::DragFloatRange2("Density Range", &config.densityMapConfig.range.x, &config.densityMapConfig.range.y,
+				0.01f, 0.0f, 1.0f);
+			drawTooltip("Map values that grow no blades and all the blades.");
+			if (ImGui::Button("Generate Density Map"))
+			{
+				config.densityMapConfig.seed = (uint32_t)rand();
+				generateDensityMap();
+			}
+			ImGui::InputText("Density Map Path", densityMapPath, sizeof(densityMapPath));
+			if (ImGui::Button("Load Density Map"))
+			{
+				loadDensityMap();
+			}
+			drawTooltip("Loads a painted density map, its red channel is the density.");
+		}
+
+		if (config.simulationMode != SimulationMode::FLUID_GRID &&
+			config.simulationMode != SimulationMode::FLUID_FLIPBOOK)
 		{
 			ImGui::SliderFloat("Wind Strength", &config.windStrength, 0, 0.5f);
 			drawTooltip("Strength of the wind");
@@ -972,24 +1750,67 @@ namespace GrassSimulation {
 		if (config.simulationMode == SimulationMode::PERLIN_NOISE && ImGui::CollapsingHeader(
 			"Perlin Noise Settings"))
 		{
-			ImGui::SliderInt("Octaves", &config.perlinConfig.octaves, 2, 10);
+			// Regenerating is cheap enough to follow the sliders
+			if (ImGui::SliderInt("Octaves", &config.perlinConfig.octaves, 2, 10))
+				generatePerlinNoiseTexture();
 			drawTooltip("Octaves for fun.");
 
-			ImGui::SliderFloat("Bias", &config.perlinConfig.bias, 0.2f, 2.0f);
+			if (ImGui::SliderFloat("Bias", &config.perlinConfig.bias, 0.2f, 2.0f))
+				generatePerlinNoiseTexture();
 			drawTooltip("Bias for fun.");
 
+			ImGui::Checkbox("Generate On CPU", &config.perlinConfig.generateOnCPU);
+			drawTooltip("For when compute shaders are not available.");
+
+			if (ImGui::Checkbox("Stream Non-Repeating Noise", &config.perlinConfig.streaming))
+			{
+				setWindTexturesForSimulationMode();
+			}
+			drawTooltip("Generates the gradient noise the wind blows into view every frame, so the wind never repeats.");
+
+			if (ImGui::RadioButton("Gradient Noise", config.perlinConfig.generator == NoiseGenerator::GRADIENT_NOISE))
+			{
+				config.perlinConfig.generator = NoiseGenerator::GRADIENT_NOISE;
+				generatePerlinNoiseTexture();
+			}
+			ImGui::SameLine();
+			if (ImGui::RadioButton("Value Noise", config.perlinConfig.generator == NoiseGenerator::VALUE_NOISE))
+			{
+				config.perlinConfig.generator = NoiseGenerator::VALUE_NOISE;
+				generatePerlinNoiseTexture();
+			}
+			drawTooltip("Gradient noise interpolates hashed gradients, value noise hashed values.");
+
 			if (ImGui::Button("Generate Perlin Noise"))
 			{
+				config.perlinConfig.seed = (uint32_t)rand();
 				generatePerlinNoiseTexture();
 			}
+			if (!config.perlinConfig.generateOnCPU)
+				ImGui::Text("Generated in %.3fms on the GPU", noiseGpuTimer->getMilliseconds());
+			if (config.perlinConfig.streaming)
+				ImGui::Text("Streamed %d pixels this frame", streamingNoise->getGeneratedPixels());
+			drawWindTextureCacheStats();
+
 			float width = PERLIN_NOISE_TEXTURE_WIDTH;
 
-			ImGui::Image((ImTextureID)(long long)config.perlinConfig.texture->getTextureID(),
+			ImGui::Image((ImTextureID)(long long)config.windX->getTextureID(),
 				{ width, width },
 				{ 0.0f, 1.0f },
 				{ 1.0f, 0.0f });
 		}
 
+		if (config.simulationMode == SimulationMode::FLUID_FLIPBOOK && ImGui::CollapsingHeader("Fluid Flipbook Settings"))
+		{
+			drawFlipbookPlaybackSettings();
+		}
+
+		if ((config.simulationMode == SimulationMode::FLUID_GRID || config.simulationMode == SimulationMode::FLUID_FLIPBOOK) &&
+			ImGui::CollapsingHeader("Particle Settings"))
+		{
+			drawParticleSettings();
+		}
+
 		if (config.simulationMode == SimulationMode::CHECKER_PATTERN && ImGui::CollapsingHeader("Checker Pattern Settings"))
 		{
 			if (ImGui::SliderInt("CheckerSize", &config.checkerSize, 1, 512))
@@ -997,6 +1818,7 @@ namespace GrassSimulation {
 				generateCheckerPatternTexture();
 			}
 			drawTooltip("Checker size for fun. Only powers of two look nice.");
+			drawWindTextureCacheStats();
 		}
 	}
 
@@ -0,0 +1,195 @@
+#include "impostor_cards.h"
+#include "patch.h"
+#include "scene.h"
+#include "logger.h"
+#include <rendering/scene_object_multi_draw.h>
+#include <rendering/primitives.h>
+#include <rendering/shader_program.h>
+#include <rendering/texture.h>
+#include <rendering/mesh_registry.h>
+#include <rendering/vertex_layout.h>
+#include <rendering/gl_state.h>
+
+#include <algorithm>
+
+namespace
+{
+	/**
+	 * \brief Size of the card texture, as wide as a patch and as tall as a
+	 * blade
+	 */
+	const int IMPOSTOR_TEXTURE_WIDTH = 1024;
+	const int IMPOSTOR_TEXTURE_HEIGHT = 256;
+
+	/**
+	 * \brief Cards a patch has in each direction, see impostorCardPositions
+	 */
+	const int CARDS_PER_DIRECTION = 3;
+
+	/**
+	 * \brief Texels covered less than this are left out of the cards
+	 */
+	const float ALPHA_CUTOFF = 0.4f;
+}
+
+ImpostorCards::ImpostorCards()
+{
+	std::vector<std::string> multiDrawDefines;
+	if (SceneObjectMultiDraw::isDrawIdSupported())
+		multiDrawDefines.push_back(MULTI_DRAW_ID_DEFINE);
+
+	cardVertexShader = new Shader("assets/shaders/impostor.vert", GL_VERTEX_SHADER, multiDrawDefines);
+	cardFragmentShader = new Shader("assets/shaders/impostor.frag", GL_FRAGMENT_SHADER);
+	cardShaderProgram = new ShaderProgram({ cardVertexShader, cardFragmentShader }, "IMPOSTOR SHADER");
+	cards = new SceneObjectMultiDraw(impostorCardPositions, impostorCardColors, impostorCardIndices,
+		impostorCardNormals, *cardShaderProgram, &impostorCardUVs);
+
+	bakeVertexShader = new Shader("assets/shaders/impostor_bake.vert", GL_VERTEX_SHADER);
+	bakeFragmentShader = new Shader("assets/shaders/impostor_bake.frag", GL_FRAGMENT_SHADER);
+	bakeShaderProgram = new ShaderProgram({ bakeVertexShader, bakeFragmentShader }, "IMPOSTOR BAKE SHADER");
+
+	texture = new Texture("Impostor Cards", GL_TEXTURE_2D);
+	GLCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, IMPOSTOR_TEXTURE_WIDTH, IMPOSTOR_TEXTURE_HEIGHT, 0,
+		GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
+	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+	// The cards show the blades with an offset and wrap around
+	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT));
+	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+	texture->generateMipmap();
+
+	GLint previousFramebuffer = 0;
+	GLCall(glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer));
+	GLCall(glGenFramebuffers(1, &bakeFramebuffer));
+	GLCall(glBindFramebuffer(GL_FRAMEBUFFER, bakeFramebuffer));
+	GLCall(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture->getTextureID(), 0));
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		LOG_ERROR("The impostor card framebuffer is not complete.");
+	}
+	GLCall(glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer));
+
+	// The blade mesh, its instances are bound by bake
+	GLCall(glGenVertexArrays(1, &bakeVertexArray));
+	GLState::bindVertexArray(bakeVertexArray);
+
+	// The same buffers as the blades, the uvs do not tell them apart
+	std::vector<PackedVertex> vertices = packVertices(grassPositions, grassColors, grassNormals, &grassUVs);
+	bakeMesh = MeshRegistry::instance().acquire(vertices.data(), vertices.size() * sizeof(PackedVertex), grassIndices);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, bakeMesh->vertexBuffer);
+	setVertexLayout(PACKED_VERTEX_LAYOUT, *bakeShaderProgram, 0, false);
+	GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, bakeMesh->indexBuffer);
+	GLState::bindVertexArray(0);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+
+	for (size_t i = 1; i < grassPositions.size(); i += 3)
+	{
+		bladeTop = std::max(bladeTop, grassPositions[i]);
+	}
+}
+
+ImpostorCards::~ImpostorCards()
+{
+	GLCall(glDeleteFramebuffers(1, &bakeFramebuffer));
+	GLState::deleteVertexArray(bakeVertexArray);
+	MeshRegistry::instance().release(bakeMesh);
+	delete texture;
+	delete cards;
+	delete cardShaderProgram;
+	delete cardVertexShader;
+	delete cardFragmentShader;
+	delete bakeShaderProgram;
+	delete bakeVertexShader;
+	delete bakeFragmentShader;
+}
+
+void ImpostorCards::bake(unsigned int bladeInstanceBuffer, int numBlades, float patchSize)
+{
+	GLint previousFramebuffer = 0;
+	GLint viewport[4] = { 0, 0, 0, 0 };
+	GLfloat clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	GLCall(glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer));
+	GLCall(glGetIntegerv(GL_VIEWPORT, viewport));
+	GLCall(glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor));
+	GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+	GLboolean blend = glIsEnabled(GL_BLEND);
+	GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+
+	GLCall(glBindFramebuffer(GL_FRAMEBUFFER, bakeFramebuffer));
+	GLCall(glViewport(0, 0, IMPOSTOR_TEXTURE_WIDTH, IMPOSTOR_TEXTURE_HEIGHT));
+	GLState::disable(GL_DEPTH_TEST);
+	GLState::disable(GL_BLEND);
+	GLState::disable(GL_CULL_FACE);
+	// Uncovered texels have the color of the blades too, so filtering does
+	// not darken their edges
+	GLCall(glClearColor(grassColors[0], grassColors[1], grassColors[2], 0.0f));
+	GLCall(glClear(GL_COLOR_BUFFER_BIT));
+
+	// Every third blade goes on the cards, the blades of a patch are spread
+	// evenly however many of them are taken
+	int bakedBlades = numBlades / CARDS_PER_DIRECTION;
+	if (bakedBlades > 0 && patchSize > 0.0f)
+	{
+		bakeShaderProgram->use();
+		bakeShaderProgram->setFloat("patchSize", patchSize);
+		bakeShaderProgram->setFloat("bladeTop", bladeTop);
+
+		GLuint program = bakeShaderProgram->getShaderProgramId();
+		GLState::bindVertexArray(bakeVertexArray);
+		GLState::bindBuffer(GL_ARRAY_BUFFER, bladeInstanceBuffer);
+		for (const InstanceAttribute& attribute : BLADE_INSTANCE_LAYOUT.attributes)
+		{
+			GLint location = glGetAttribLocation(program, attribute.name);
+			if (location < 0)
+				continue;
+			GLCall(glEnableVertexAttribArray(location));
+			GLCall(glVertexAttribPointer(location, attribute.size, attribute.type, attribute.normalized,
+				BLADE_INSTANCE_LAYOUT.stride * CARDS_PER_DIRECTION, (const void*)attribute.offset));
+			GLCall(glVertexAttribDivisor(location, 1));
+		}
+		GLCall(glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)bakeMesh->indexCount, bakeMesh->indexType, nullptr, bakedBlades));
+		GLState::bindVertexArray(0);
+		GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	GLCall(glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer));
+	GLCall(glViewport(viewport[0], viewport[1], viewport[2], viewport[3]));
+	GLCall(glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]));
+	if (depthTest)
+		GLState::enable(GL_DEPTH_TEST);
+	if (blend)
+		GLState::enable(GL_BLEND);
+	if (cullFace)
+		GLState::enable(GL_CULL_FACE);
+
+	texture->bind();
+	texture->generateMipmap();
+}
+
+void ImpostorCards::draw(Scene& scene)
+{
+	if (cards->getMaxDraws() == 0)
+		return;
+
+	cardShaderProgram->use();
+	texture->activate();
+	texture->bind();
+	cardShaderProgram->setInt("impostorTexture", (int)texture->getTextureID());
+	cardShaderProgram->setFloat("alphaCutoff", ALPHA_CUTOFF);
+
+	// Both sides of the cards are seen
+	GLState::enable(GL_SAMPLE_ALPHA_TO_COVERAGE);
+	cards->draw(scene);
+	GLState::disable(GL_SAMPLE_ALPHA_TO_COVERAGE);
+}
+
+void ImpostorCards::reloadShaders()
+{
+	cardShaderProgram->reloadShaders();
+	bakeShaderProgram->reloadShaders();
+}
+
+SceneObjectMultiDraw& ImpostorCards::getCards()
+{
+	return *cards;
+}
@@ -0,0 +1,84 @@
+#ifndef IMPOSTOR_CARDS_H
+#define IMPOSTOR_CARDS_H
+
+#include <glad/glad.h>
+
+class Scene;
+struct Mesh;
+class SceneObjectMultiDraw;
+class Shader;
+class ShaderProgram;
+class Texture;
+
+/**
+ * \brief Settings of the far field level of detail.
+ * startDistance:	Patches further from the camera than this are drawn as
+ *					impostor cards instead of blades.
+ */
+struct ImpostorConfig
+{
+	bool  enabled = true;
+	float startDistance = 100.0f;
+};
+
+/**
+ * \brief Draws far patches as a few crossed cards with blades painted on
+ * them, instead of thousands of blades that are smaller than a pixel.
+ * The blades are baked into the card texture from the template patch, seen
+ * from the front, and the cards sway in the wind like the blades do. Which
+ * patches get cards is up to the PatchField, one draw per patch.
+ */
+class ImpostorCards
+{
+public:
+	ImpostorCards();
+	~ImpostorCards();
+
+	ImpostorCards(const ImpostorCards&) = delete;
+	ImpostorCards& operator=(const ImpostorCards&) = delete;
+
+	/**
+	 * \brief Renders the blades of the template patch into the card texture.
+	 * Every card of a patch shows a third of them, so the cards together
+	 * cover as much as the blades do.
+	 * \param bladeInstanceBuffer The BladeInstance of every blade of the
+	 * template patch.
+	 * \param numBlades Blades drawn on a patch, the first ones of the buffer.
+	 */
+	void bake(unsigned int bladeInstanceBuffer, int numBlades, float patchSize);
+
+	void draw(Scene& scene);
+
+	void reloadShaders();
+
+	/**
+	 * \brief The cards, their draw models are set by the PatchField
+	 */
+	SceneObjectMultiDraw& getCards();
+
+private:
+	Shader* cardVertexShader = nullptr;
+	Shader* cardFragmentShader = nullptr;
+	ShaderProgram* cardShaderProgram = nullptr;
+	SceneObjectMultiDraw* cards = nullptr;
+
+	Shader* bakeVertexShader = nullptr;
+	Shader* bakeFragmentShader = nullptr;
+	ShaderProgram* bakeShaderProgram = nullptr;
+
+	/**
+	 * \brief Blade mesh drawn by the bake, once per blade
+	 */
+	GLuint bakeVertexArray = 0;
+	const Mesh* bakeMesh = nullptr;
+	GLuint bakeFramebuffer = 0;
+
+	Texture* texture = nullptr;
+
+	/**
+	 * \brief Height of the blade mesh before it is scaled by the blade height
+	 */
+	float bladeTop = 0.0f;
+};
+
+#endif
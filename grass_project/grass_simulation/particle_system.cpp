@@ -0,0 +1,230 @@
+#include "particle_system.h"
+#include "scene.h"
+#include "thread_pool.h"
+#include <rendering/scene_object_instanced.h>
+#include <rendering/primitives.h>
+#include <rendering/gl_state.h>
+
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PARTICLE_SYSTEM_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	/**
+	 * \brief Number of per particle arrays in the storage.
+	 */
+	const int PARTICLE_ARRAYS = 10;
+
+	/**
+	 * \brief Particles per thread pool job. A multiple of four, so only the
+	 * last job has a scalar tail.
+	 */
+	const size_t PARTICLES_PER_JOB = 2048;
+
+	/**
+	 * \brief Cheap random numbers, one generator per job so the threads never
+	 * share state.
+	 */
+	struct ParticleRandom
+	{
+		uint32_t state;
+
+		explicit ParticleRandom(uint32_t seed) : state(seed ? seed : 0x9E3779B9u) {}
+
+		float next(float min, float max)
+		{
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return min + (max - min) * (float)(state >> 8) * (1.0f / 16777216.0f);
+		}
+	};
+}
+
+void applyParticleTypePreset(ParticleConfig& config, ParticleType type)
+{
+	config.type = type;
+	switch (type)
+	{
+	case ParticleType::LEAVES:
+		config.size = 0.25f;
+		config.color = { 0.55f, 0.42f, 0.12f, 1.0f };
+		config.windResponse = 1.5f;
+		config.fallSpeed = 0.6f;
+		break;
+	case ParticleType::POLLEN:
+		config.size = 0.06f;
+		config.color = { 0.95f, 0.85f, 0.35f, 1.0f };
+		config.windResponse = 6.0f;
+		config.fallSpeed = 0.05f;
+		break;
+	case ParticleType::DUST:
+		config.size = 0.03f;
+		config.color = { 0.75f, 0.7f, 0.6f, 1.0f };
+		config.windResponse = 8.0f;
+		config.fallSpeed = 0.15f;
+		break;
+	}
+}
+
+ParticleSystem::ParticleSystem(int maxParticles, ShaderProgram& shaderProgram)
+	: maxParticles(maxParticles)
+{
+	// Padded to whole SIMD registers
+	size_t stride = ((size_t)maxParticles + 3) & ~(size_t)3;
+	storage = new float[stride * PARTICLE_ARRAYS]();
+	float** arrays[PARTICLE_ARRAYS] = { &posX, &posY, &posZ, &velX, &velY, &velZ, &age, &lifetime, &windX, &windY };
+	for (int i = 0; i < PARTICLE_ARRAYS; i++)
+	{
+		*arrays[i] = storage + i * stride;
+	}
+	// Every particle starts out dead, age == lifetime == 0, so the first
+	// update spawns them inside the world.
+
+	instanceMatrices = new glm::mat4[maxParticles];
+
+	GLCall(glGenBuffers(1, &instanceMatrixBuffer));
+	GLState::bindBuffer(GL_ARRAY_BUFFER, instanceMatrixBuffer);
+	GLCall(glBufferData(GL_ARRAY_BUFFER, maxParticles * sizeof(glm::mat4), nullptr, GL_STREAM_DRAW));
+	GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+
+	sceneObject = new SceneObjectInstanced(particleQuadPositions, particleQuadColors, particleQuadIndices,
+		particleQuadNormals, instanceMatrixBuffer, shaderProgram, &particleQuadUVs);
+	sceneObject->model = glm::mat4(1);
+	sceneObject->instanceCount = 0;
+	sceneObject->isVisible = false;
+}
+
+ParticleSystem::~ParticleSystem()
+{
+	delete sceneObject;
+	GLState::deleteBuffer(instanceMatrixBuffer);
+	delete[] instanceMatrices;
+	delete[] storage;
+}
+
+void ParticleSystem::update(float deltaTime, Scene& scene, ThreadPool& threadPool)
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	ParticleConfig& config = scene.config.particleConfig;
+	activeParticles = glm::clamp(config.count, 0, maxParticles);
+	frameIndex++;
+
+	if (scene.config.fluidGridConfig.fluidGrid)
+	{
+		threadPool.parallelFor((size_t)activeParticles, PARTICLES_PER_JOB, [&](size_t begin, size_t end)
+			{
+				updateRange(begin, end, deltaTime, scene);
+			});
+	}
+
+	// Orphan the buffer, so the driver does not wait for the last frame's draw
+	GLState::bindBuffer(GL_ARRAY_BUFFER, instanceMatrixBuffer);
+	GLCall(glBufferData(GL_ARRAY_BUFFER, maxParticles * sizeof(glm::mat4), nullptr, GL_STREAM_DRAW));
+	GLCall(glBufferSubData(GL_ARRAY_BUFFER, 0, activeParticles * sizeof(glm::mat4), instanceMatrices));
+	GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+	sceneObject->instanceCount = activeParticles;
+
+	updateMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void ParticleSystem::updateRange(size_t begin, size_t end, float deltaTime, Scene& scene)
+{
+	const ParticleConfig& config = scene.config.particleConfig;
+	const float worldMin = scene.config.worldMin;
+	const float worldMax = scene.config.worldMax;
+	size_t count = end - begin;
+
+	scene.sampleWindVelocities(posX + begin, posZ + begin, count, windX + begin, windY + begin);
+
+	// The grid velocity is in whole grids per second, and its y axis points
+	// towards -z, see Scene::mapPositionFromWorldSpace.
+	const float windScale = config.windInfluence * (worldMax - worldMin);
+	const float response = 1.0f - std::exp(-config.windResponse * deltaTime);
+	const float fall = -config.fallSpeed;
+
+	size_t i = begin;
+
+#ifdef PARTICLE_SYSTEM_USE_SSE2
+	const __m128 windScaleV = _mm_set1_ps(windScale);
+	const __m128 negWindScaleV = _mm_set1_ps(-windScale);
+	const __m128 responseV = _mm_set1_ps(response);
+	const __m128 fallV = _mm_set1_ps(fall);
+	const __m128 deltaTimeV = _mm_set1_ps(deltaTime);
+
+	for (; i + 4 <= end; i += 4)
+	{
+		__m128 targetX = _mm_mul_ps(_mm_loadu_ps(windX + i), windScaleV);
+		__m128 targetZ = _mm_mul_ps(_mm_loadu_ps(windY + i), negWindScaleV);
+
+		__m128 vx = _mm_loadu_ps(velX + i);
+		__m128 vy = _mm_loadu_ps(velY + i);
+		__m128 vz = _mm_loadu_ps(velZ + i);
+		vx = _mm_add_ps(vx, _mm_mul_ps(_mm_sub_ps(targetX, vx), responseV));
+		vy = _mm_add_ps(vy, _mm_mul_ps(_mm_sub_ps(fallV, vy), responseV));
+		vz = _mm_add_ps(vz, _mm_mul_ps(_mm_sub_ps(targetZ, vz), responseV));
+		_mm_storeu_ps(velX + i, vx);
+		_mm_storeu_ps(velY + i, vy);
+		_mm_storeu_ps(velZ + i, vz);
+
+		_mm_storeu_ps(posX + i, _mm_add_ps(_mm_loadu_ps(posX + i), _mm_mul_ps(vx, deltaTimeV)));
+		_mm_storeu_ps(posY + i, _mm_add_ps(_mm_loadu_ps(posY + i), _mm_mul_ps(vy, deltaTimeV)));
+		_mm_storeu_ps(posZ + i, _mm_add_ps(_mm_loadu_ps(posZ + i), _mm_mul_ps(vz, deltaTimeV)));
+		_mm_storeu_ps(age + i, _mm_add_ps(_mm_loadu_ps(age + i), deltaTimeV));
+	}
+#endif
+
+	for (; i < end; i++)
+	{
+		velX[i] += (windX[i] * windScale - velX[i]) * response;
+		velY[i] += (fall - velY[i]) * response;
+		velZ[i] += (-windY[i] * windScale - velZ[i]) * response;
+		posX[i] += velX[i] * deltaTime;
+		posY[i] += velY[i] * deltaTime;
+		posZ[i] += velZ[i] * deltaTime;
+		age[i] += deltaTime;
+	}
+
+	// Respawning is rare, so it does not need to be vectorized
+	ParticleRandom random(frameIndex * 0x9E3779B9u ^ (uint32_t)begin * 0x85EBCA6Bu);
+	for (i = begin; i < end; i++)
+	{
+		if (age[i] >= lifetime[i] || posY[i] < 0.0f ||
+			posX[i] < worldMin || posX[i] > worldMax || posZ[i] < worldMin || posZ[i] > worldMax)
+		{
+			posX[i] = random.next(worldMin, worldMax);
+			posY[i] = random.next(0.0f, config.spawnHeight);
+			posZ[i] = random.next(worldMin, worldMax);
+			velX[i] = velY[i] = velZ[i] = 0.0f;
+			age[i] = 0.0f;
+			lifetime[i] = random.next(config.lifetimeRange.x, config.lifetimeRange.y);
+		}
+
+		glm::mat4& matrix = instanceMatrices[i];
+		matrix[0] = { config.size, 0.0f, 0.0f, 0.0f };
+		matrix[1] = { 0.0f, config.size, 0.0f, 0.0f };
+		matrix[2] = { 0.0f, 0.0f, config.size, 0.0f };
+		matrix[3] = { posX[i], posY[i], posZ[i], 1.0f };
+	}
+}
+
+SceneObjectInstanced* ParticleSystem::getSceneObject()
+{
+	return sceneObject;
+}
+
+int ParticleSystem::getMaxParticles() const
+{
+	return maxParticles;
+}
+
+float ParticleSystem::getUpdateMilliseconds() const
+{
+	return updateMilliseconds;
+}
@@ -0,0 +1,119 @@
+#ifndef PARTICLE_SYSTEM_H
+#define PARTICLE_SYSTEM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+class Scene;
+class SceneObjectInstanced;
+class ShaderProgram;
+class ThreadPool;
+
+/**
+* Represents what the particles look like and how they move
+*
+* LEAVES:	Large, slow to pick up the wind and falling.
+* POLLEN:	Small, follows the wind closely and hardly falls.
+* DUST:		Tiny, follows the wind closely and falls slowly.
+*/
+enum class ParticleType {
+	LEAVES,
+	POLLEN,
+	DUST
+};
+
+/**
+ * \brief Settings of the wind particles.
+ * windInfluence:	Multiplies the fluid grid velocity, which is in whole
+ *					grids per second, after mapping it to world space.
+ * windResponse:	How quickly particles take on the wind velocity, per second.
+ * fallSpeed:		Speed the particles fall at in still air.
+ * lifetimeRange:	Particles live a random time in this range, in seconds.
+ */
+struct ParticleConfig
+{
+	bool        enabled = false;
+	ParticleType type = ParticleType::POLLEN;
+	int         count = 20000;
+	float       size = 0.06f;
+	glm::vec4   color = { 0.95f, 0.85f, 0.35f, 1.0f };
+	float       windInfluence = 1.0f;
+	float       windResponse = 6.0f;
+	float       fallSpeed = 0.05f;
+	float       spawnHeight = 4.0f;
+	glm::vec2   lifetimeRange = { 4.0f, 12.0f };
+};
+
+/**
+ * \brief Sets the look and movement settings of config to those of type.
+ */
+void applyParticleTypePreset(ParticleConfig& config, ParticleType type);
+
+/**
+ * \brief Particles that are carried by the fluid grid wind, drawn as camera
+ * facing quads with one instanced draw.
+ * The particle state is stored as separate arrays per component, so the
+ * integration can process four particles at a time with SIMD. The particles
+ * are split between the threads of a ThreadPool.
+ */
+class ParticleSystem
+{
+public:
+	ParticleSystem(int maxParticles, ShaderProgram& shaderProgram);
+	~ParticleSystem();
+
+	ParticleSystem(const ParticleSystem&) = delete;
+	ParticleSystem& operator=(const ParticleSystem&) = delete;
+
+	/**
+	 * \brief Moves the particles through the wind of the scene's fluid grid,
+	 * respawns the ones that died or left the world and uploads the instance
+	 * matrices.
+	 */
+	void update(float deltaTime, Scene& scene, ThreadPool& threadPool);
+
+	/**
+	 * \brief Scene object that draws the particles.
+	 */
+	SceneObjectInstanced* getSceneObject();
+
+	int getMaxParticles() const;
+
+	/**
+	 * \brief Time the last update took on the CPU, in milliseconds.
+	 */
+	float getUpdateMilliseconds() const;
+
+private:
+	/**
+	 * \brief Updates the particles in [begin, end).
+	 */
+	void updateRange(size_t begin, size_t end, float deltaTime, Scene& scene);
+
+	int maxParticles = 0;
+	int activeParticles = 0;
+	uint32_t frameIndex = 0;
+	float updateMilliseconds = 0.0f;
+
+	/**
+	 * \brief One allocation holding all the arrays below.
+	 */
+	float* storage = nullptr;
+	float* posX = nullptr;
+	float* posY = nullptr;
+	float* posZ = nullptr;
+	float* velX = nullptr;
+	float* velY = nullptr;
+	float* velZ = nullptr;
+	float* age = nullptr;
+	float* lifetime = nullptr;
+	float* windX = nullptr;
+	float* windY = nullptr;
+
+	glm::mat4* instanceMatrices = nullptr;
+	unsigned int instanceMatrixBuffer = 0;
+	SceneObjectInstanced* sceneObject = nullptr;
+};
+
+#endif
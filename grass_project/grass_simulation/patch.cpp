@@ -3,20 +3,55 @@
 #include "rendering/scene_object.h"
 #include "rendering/primitives.h"
 #include "rendering/scene_object_indexed.h"
+#include "rendering/scene_object_multi_draw.h"
+#include <glm/gtc/packing.hpp>
 #include <algorithm>
+#include <cstddef>
+#include <numeric>
 #include <stdlib.h>     /* srand, rand */
 
+namespace {
+	/**
+	* Interleaves the bits of x and z, x in the even bits.
+	*/
+	unsigned int mortonCode(unsigned int x, unsigned int z) {
+		unsigned int code = 0;
+		for (unsigned int bit = 0; bit < 16; bit++) {
+			code |= ((x >> bit) & 1u) << (2 * bit);
+			code |= ((z >> bit) & 1u) << (2 * bit + 1);
+		}
+		return code;
+	}
+
+	unsigned int reverseBits(unsigned int value, unsigned int bits) {
+		unsigned int reversed = 0;
+		for (unsigned int bit = 0; bit < bits; bit++) {
+			reversed = (reversed << 1) | ((value >> bit) & 1u);
+		}
+		return reversed;
+	}
+}
+
+const VertexLayout BLADE_INSTANCE_LAYOUT = {
+	{
+		{ "bladePosition", 2, GL_HALF_FLOAT, GL_FALSE, offsetof(BladeInstance, position) },
+		// The missing w of bladeShape reads as one, the full width
+		{ "bladeShape", 2, GL_SHORT, GL_TRUE, offsetof(BladeInstance, angles) },
+	},
+	sizeof(BladeInstance)
+};
+
 Patch::Patch() {
 }
 
 Patch::~Patch() {
-	delete bladeMatrices;
+	delete[] bladeInstances;
 }
 
 void Patch::init(int numBlades, ShaderProgram* shaderProgram) {
 	this->numBlades = numBlades;
 	this->shaderProgram = shaderProgram;
-	this->bladeMatrices = new glm::mat4[numBlades];
+	this->bladeInstances = new BladeInstance[numBlades];
 }
 
 void Patch::initHarryEdwardStylesBladeMatrices(float patchSize, bool useRandomRotations) {
@@ -30,23 +65,26 @@ void Patch::initHarryEdwardStylesBladeMatrices(float patchSize, bool useRandomRo
 	constexpr float swayX = glm::radians(20.0f);
 	constexpr float swayY = glm::radians(180.0f);
 
+	std::vector<glm::vec2> positions(numBlades);
+	std::vector<glm::vec2> angles(numBlades, glm::vec2(0.0f));
+
 	// Distribute the blades uniformly within the patch
 	for (int x = 0; x < numBlades; x += 1) {
 		float randomPosX = generateRandomNumber(lowerBoundX, upperBoundX);
 		float randomPosZ = generateRandomNumber(lowerBoundZ, upperBoundZ);
 
-		glm::vec3 grassCoordinate = glm::vec3(randomPosX, 0, randomPosZ) * patchSize;
-
-		bladeMatrices[x] = glm::translate(grassCoordinate);
+		positions[x] = glm::vec2(randomPosX, randomPosZ) * patchSize;
 
 		// Apply a random rotation within the sway bounds to each blade
 		if (useRandomRotations) {
 			float randomRotX = generateRandomNumber(-swayX, swayX);
 			float randomRotY = generateRandomNumber(-swayY, swayY);
-			bladeMatrices[x] *= glm::rotateX(randomRotX) * glm::rotateY(randomRotY);
+			angles[x] = glm::vec2(randomRotY, randomRotX);
 		}
 
 	}
+
+	storeBlades(positions, angles);
 }
 void Patch::initOneDirectionBladeMatrices(float patchSize) {
 
@@ -61,16 +99,67 @@ void Patch::initOneDirectionBladeMatrices(float patchSize) {
 
 	float middleX = (upperBoundX + lowerBoundX) / 2;
 
+	std::vector<glm::vec2> positions(numBlades);
+	std::vector<glm::vec2> angles(numBlades, glm::vec2(0.0f));
+
 	// Distribute the blades in the middle of the patch
 	for (int x = 0; x < numBlades; x += 1) {
 		float z = lowerBoundZ + ((upperBoundZ - lowerBoundZ) / (numBlades)) * x;
 
-		glm::vec3 grassCoordinate = glm::vec3(middleX, 0, z) * patchSize;
+		positions[x] = glm::vec2(middleX, z) * patchSize;
+	}
+
+	storeBlades(positions, angles);
+}
+
+void Patch::storeBlades(const std::vector<glm::vec2>& positions, const std::vector<glm::vec2>& angles) {
+	if (numBlades <= 0)
+		return;
+
+	// A grid with about one blade per cell
+	unsigned int levels = 1;
+	while ((1 << (2 * levels)) < numBlades && levels < 15)
+		levels++;
+	unsigned int cells = 1u << levels;
+
+	glm::vec2 min = positions[0];
+	glm::vec2 max = min;
+	for (int i = 1; i < numBlades; i++) {
+		min = glm::min(min, positions[i]);
+		max = glm::max(max, positions[i]);
+	}
+	glm::vec2 extent = glm::max(max - min, glm::vec2(1e-6f));
+
+	// Visiting the cells in bit reversed Morton order halves the spacing
+	// every four steps: the first four cells are in different quadrants, the
+	// first sixteen in different sixteenths and so on. Blades that share a
+	// cell wait for the next round over the cells.
+	std::vector<unsigned int> cellOrder(numBlades);
+	for (int i = 0; i < numBlades; i++) {
+		glm::vec2 cell = (positions[i] - min) / extent * (float)cells;
+		unsigned int cellX = (unsigned int)glm::clamp((int)cell.x, 0, (int)cells - 1);
+		unsigned int cellZ = (unsigned int)glm::clamp((int)cell.y, 0, (int)cells - 1);
+		cellOrder[i] = reverseBits(mortonCode(cellX, cellZ), 2 * levels);
+	}
+
+	std::vector<int> cellRounds(cells * cells, 0);
+	std::vector<unsigned long long> keys(numBlades);
+	for (int i = 0; i < numBlades; i++) {
+		unsigned long long round = (unsigned long long)cellRounds[cellOrder[i]]++;
+		keys[i] = round * cells * cells + cellOrder[i];
+	}
+
+	std::vector<int> order(numBlades);
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&](int a, int b) { return keys[a] < keys[b]; });
 
-		bladeMatrices[x] = glm::translate(grassCoordinate);
+	for (int i = 0; i < numBlades; i++) {
+		int blade = order[i];
+		bladeInstances[i].position = glm::packHalf2x16(positions[blade]);
+		bladeInstances[i].angles = glm::packSnorm2x16(angles[blade] / glm::pi<float>());
 	}
 }
 
-glm::mat4* Patch::getBladeMatrices() {
-	return bladeMatrices;
+BladeInstance* Patch::getBladeInstances() {
+	return bladeInstances;
 }
@@ -5,9 +5,40 @@
 #include <vector>
 #include "rendering/shader_program.h"
 
+struct VertexLayout;
+
+/**
+* Where a blade stands in its patch, packed into 8 bytes. blades.vert and
+* blade_culling.comp rebuild its transformation, see blade_instance.glsl.
+*/
+struct BladeInstance {
+	/**
+	* x and z within the patch, as two half floats.
+	*/
+	glm::uint32 position;
+
+	/**
+	* Rotation around the y-axis, then around the x-axis, in half turns, as
+	* two snorm16.
+	*/
+	glm::uint32 angles;
+};
+
+/**
+* Feeds BladeInstance to the bladePosition and bladeShape attributes of
+* blades.vert.
+*/
+extern const VertexLayout BLADE_INSTANCE_LAYOUT;
+
+/**
+* Define that makes blades.vert and blades_tess.vert place every blade
+* procedurally, without the bladePosition and bladeShape attributes.
+*/
+const char* const PROCEDURAL_BLADES_DEFINE = "PROCEDURAL_BLADES";
+
 /**
 * Represent the patch on which blades are drawn. Also contains the
-* transformation (position and rotation) of each blade in the patch.
+* placement (position and rotation) of each blade in the patch.
 */
 class Patch {
 public:
@@ -34,12 +65,20 @@ public:
 	void initOneDirectionBladeMatrices(float patchSize);
 
 	/**
-	* Stores the transformation of all the blades in a patch.
+	* Stores the placement of all the blades in a patch.
 	*/
-	glm::mat4* getBladeMatrices();
+	BladeInstance* getBladeInstances();
 
 private:
-	glm::mat4* bladeMatrices = nullptr;
+	/**
+	* Reorders the blades so that the first n of them are spread over the
+	* whole patch for any n, letting distant patches draw only a prefix of
+	* the blades, see PatchField. Then packs them into bladeInstances.
+	* \param angles Rotation around the y-axis and around the x-axis, in radians.
+	*/
+	void storeBlades(const std::vector<glm::vec2>& positions, const std::vector<glm::vec2>& angles);
+
+	BladeInstance* bladeInstances = nullptr;
 	int numBlades = 0;
 	ShaderProgram* shaderProgram = nullptr;
 };
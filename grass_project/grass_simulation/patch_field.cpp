@@ -0,0 +1,189 @@
+#include "patch_field.h"
+#include "scene.h"
+#include "grass_math.h"
+#include <rendering/scene_object_multi_draw.h>
+
+#include <glad/glad.h>
+#include <chrono>
+
+void PatchField::build(const std::vector<glm::vec2>& positions, float patchSize, float bladeHeight)
+{
+	size_t count = positions.size();
+	this->patchSize = patchSize;
+	patchModels.resize(count);
+	bladeModels.resize(count);
+	impostorModels.resize(count);
+	patchCenters.resize(count);
+	std::vector<PatchBounds> bounds(count);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		glm::vec2 position = positions[i];
+		glm::mat4 translation = glm::translate(position.x, 0, position.y);
+		patchModels[i] = translation * glm::scale(patchSize, patchSize, patchSize);
+		// Do not scale the blades
+		bladeModels[i] = translation * glm::scale(1, bladeHeight, 1);
+		// The cards of a unit patch are as tall as the blade mesh
+		impostorModels[i] = translation * glm::scale(patchSize, bladeHeight, patchSize);
+
+		// The blade mesh is less than a unit tall before it is scaled
+		bounds[i].min = { position.x, 0.0f, position.y };
+		bounds[i].max = { position.x + patchSize, bladeHeight, position.y + patchSize };
+		patchCenters[i] = (bounds[i].min + bounds[i].max) * 0.5f;
+	}
+
+	quadtree.build(bounds);
+	dirty = true;
+}
+
+void PatchField::cull(Scene& scene, SceneObjectMultiDraw& patches, SceneObjectMultiDraw& blades,
+	SceneObjectMultiDraw* impostors)
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	const Config& config = scene.config;
+	visible.clear();
+	if (config.cullingConfig.enabled)
+	{
+		Frustum frustum(scene.projection * scene.view);
+		glm::vec3 cameraPosition = glm::vec3(glm::inverse(scene.view)[3]);
+		quadtree.query(frustum, cameraPosition, config.cullingConfig.maxDistance, maxBladeSway(config), visible);
+	}
+	else
+	{
+		visible.resize(patchModels.size());
+		for (size_t i = 0; i < visible.size(); i++)
+		{
+			visible[i] = (int)i;
+		}
+	}
+
+	chooseBladeCounts(scene, impostors && config.impostorConfig.enabled);
+
+	// A still camera sees the same patches, nothing to upload
+	bool rebuilt = dirty || &blades != uploadedBlades;
+	if (rebuilt || visible != uploadedVisible)
+	{
+		visiblePatchModels.resize(visible.size());
+		visibleBladeModels.resize(visible.size());
+		for (size_t i = 0; i < visible.size(); i++)
+		{
+			visiblePatchModels[i] = patchModels[visible[i]];
+			visibleBladeModels[i] = bladeModels[visible[i]];
+		}
+		patches.setDrawModels(visiblePatchModels);
+		blades.setDrawModels(visibleBladeModels);
+
+		uploadedVisible.swap(visible);
+		uploadedBlades = &blades;
+		dirty = false;
+		// The counts follow the order of the models
+		uploadedBladeCounts.clear();
+	}
+
+	int bladesPerPatch = glm::max(scene.config.numBladesPerPatch, 0);
+	float bladeSource = scene.config.proceduralBlades ? (float)scene.config.bladeDistribution + 1.0f : 0.0f;
+	if (bladeCounts != uploadedBladeCounts || bladesPerPatch != uploadedBladesPerPatch ||
+		bladeSource != uploadedBladeSource)
+	{
+		// Widening the blades by the fraction that is missing keeps the
+		// ground covered as much as with all of them
+		bladeDensities.resize(bladeCounts.size());
+		for (size_t i = 0; i < bladeCounts.size(); i++)
+		{
+			float width = bladeCounts[i] > 0 ? (float)bladesPerPatch / (float)bladeCounts[i] : 1.0f;
+			bladeDensities[i] = glm::vec4((float)bladeCounts[i], width, bladeSource, 0.0f);
+		}
+		blades.setDrawInstanceCounts(bladeCounts);
+		blades.setDrawParameters(bladeDensities);
+		uploadedBladeCounts = bladeCounts;
+		uploadedBladesPerPatch = bladesPerPatch;
+		uploadedBladeSource = bladeSource;
+	}
+
+	if (impostors && (rebuilt || impostorPatches != uploadedImpostorPatches))
+	{
+		visibleImpostorModels.resize(impostorPatches.size());
+		for (size_t i = 0; i < impostorPatches.size(); i++)
+		{
+			visibleImpostorModels[i] = impostorModels[impostorPatches[i]];
+		}
+		impostors->setDrawModels(visibleImpostorModels);
+		uploadedImpostorPatches = impostorPatches;
+	}
+
+	cullMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void PatchField::chooseBladeCounts(Scene& scene, bool useImpostors)
+{
+	const Config& config = scene.config;
+	const DensityLodConfig& lodConfig = config.densityLodConfig;
+	float impostorDistance = config.impostorConfig.startDistance;
+	int bladesPerPatch = glm::max(config.numBladesPerPatch, 0);
+
+	// Pixels per world unit at a distance of one
+	GLint viewport[4] = { 0, 0, 0, 0 };
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	float pixelsPerUnit = scene.projection[1][1] * viewport[3] * 0.5f;
+	glm::vec3 cameraPosition = glm::vec3(glm::inverse(scene.view)[3]);
+	float minDensity = glm::clamp(lodConfig.minDensity, 0.0f, 1.0f);
+
+	bladeCounts.resize(visible.size());
+	impostorPatches.clear();
+	drawnBlades = 0;
+	for (size_t i = 0; i < visible.size(); i++)
+	{
+		float distance = glm::max(glm::distance(cameraPosition, patchCenters[visible[i]]), 1e-3f);
+		// Far patches keep their draw, without blades, so the blade draws
+		// still follow the patches
+		if (useImpostors && distance > impostorDistance)
+		{
+			bladeCounts[i] = 0;
+			impostorPatches.push_back(visible[i]);
+			continue;
+		}
+
+		float density = 1.0f;
+		if (lodConfig.enabled && lodConfig.fullDensityPixels > 0.0f)
+		{
+			float pixels = patchSize * pixelsPerUnit / distance;
+			// The blades per pixel stay the same once the patch is small
+			// enough on screen
+			float size = pixels / lodConfig.fullDensityPixels;
+			density = glm::clamp(size * size, minDensity, 1.0f);
+		}
+		bladeCounts[i] = glm::max((int)glm::ceil(density * bladesPerPatch), bladesPerPatch > 0 ? 1 : 0);
+		drawnBlades += bladeCounts[i];
+	}
+}
+
+int PatchField::getPatchCount() const
+{
+	return (int)patchModels.size();
+}
+
+int PatchField::getVisiblePatches() const
+{
+	return (int)uploadedVisible.size();
+}
+
+int PatchField::getDrawnBlades() const
+{
+	return drawnBlades;
+}
+
+int PatchField::getImpostorPatches() const
+{
+	return (int)uploadedImpostorPatches.size();
+}
+
+const PatchQuadtree& PatchField::getQuadtree() const
+{
+	return quadtree;
+}
+
+float PatchField::getCullMilliseconds() const
+{
+	return cullMilliseconds;
+}
@@ -0,0 +1,122 @@
+#ifndef PATCH_FIELD_H
+#define PATCH_FIELD_H
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "patch_quadtree.h"
+
+class Scene;
+class SceneObjectMultiDraw;
+
+/**
+ * \brief Settings of the blade density level of detail.
+ * fullDensityPixels:	Patches at least this tall on screen draw all their blades.
+ *						Smaller patches draw fewer, in proportion to their area on screen.
+ * minDensity:			Fraction of the blades the smallest patches still draw.
+ */
+struct DensityLodConfig
+{
+	bool  enabled = true;
+	float fullDensityPixels = 400.0f;
+	float minDensity = 0.07f;
+};
+
+/**
+ * \brief All the patches of the grass field, however many there are.
+ * Every frame the visible patches are looked up in a PatchQuadtree, and only
+ * their model matrices are handed to the patch and blade draws.
+ */
+class PatchField
+{
+public:
+	/**
+	 * \brief Replaces the patches, one per position, and rebuilds the
+	 * quadtree.
+	 * \param positions Corner of every patch, in world space x and z.
+	 * \param bladeHeight Vertical scale of the blades.
+	 */
+	void build(const std::vector<glm::vec2>& positions, float patchSize, float bladeHeight);
+
+	/**
+	 * \brief Finds the patches visible to the camera of scene and uploads
+	 * their model matrices to patches and blades, unless they did not change.
+	 * Takes every patch if culling is disabled.
+	 * Also picks how many blades every visible patch draws from its size on
+	 * screen, see DensityLodConfig. Blades takes them as per draw instance
+	 * counts, and as per draw parameters of x: the count, y: how much wider
+	 * the blades are drawn to make up for the missing ones and z: 0 for
+	 * blades from the instance buffer or the BladeDistribution plus one for
+	 * procedural blades.
+	 * Patches past the ImpostorConfig start distance draw no blades, their
+	 * cards are handed to impostors instead, if there are any.
+	 */
+	void cull(Scene& scene, SceneObjectMultiDraw& patches, SceneObjectMultiDraw& blades,
+		SceneObjectMultiDraw* impostors = nullptr);
+
+	int getPatchCount() const;
+
+	/**
+	 * \brief Patches found by the last cull
+	 */
+	int getVisiblePatches() const;
+
+	/**
+	 * \brief Blades the visible patches draw after the last cull
+	 */
+	int getDrawnBlades() const;
+
+	/**
+	 * \brief Patches drawn as impostor cards after the last cull
+	 */
+	int getImpostorPatches() const;
+
+	const PatchQuadtree& getQuadtree() const;
+
+	/**
+	 * \brief Time the last cull took on the CPU, in milliseconds.
+	 */
+	float getCullMilliseconds() const;
+
+private:
+	/**
+	 * \brief Fills bladeCounts for the visible patches, and impostorPatches
+	 * with the ones too far away for blades if useImpostors
+	 */
+	void chooseBladeCounts(Scene& scene, bool useImpostors);
+
+	std::vector<glm::mat4> patchModels;
+	std::vector<glm::mat4> bladeModels;
+	std::vector<glm::mat4> impostorModels;
+	std::vector<glm::vec3> patchCenters;
+	float patchSize = 0.0f;
+	PatchQuadtree quadtree;
+
+	std::vector<int> visible;
+	std::vector<int> uploadedVisible;
+	/**
+	 * \brief The blades the last upload went to
+	 */
+	const SceneObjectMultiDraw* uploadedBlades = nullptr;
+	std::vector<glm::mat4> visiblePatchModels;
+	std::vector<glm::mat4> visibleBladeModels;
+
+	std::vector<int> bladeCounts;
+	std::vector<int> uploadedBladeCounts;
+	int uploadedBladesPerPatch = -1;
+	float uploadedBladeSource = -1.0f;
+	std::vector<glm::vec4> bladeDensities;
+	int drawnBlades = 0;
+
+	std::vector<int> impostorPatches;
+	std::vector<int> uploadedImpostorPatches;
+	std::vector<glm::mat4> visibleImpostorModels;
+
+	/**
+	 * \brief The patches changed since the last upload
+	 */
+	bool dirty = true;
+	float cullMilliseconds = 0.0f;
+};
+
+#endif
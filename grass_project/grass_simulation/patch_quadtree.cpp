@@ -0,0 +1,166 @@
+#include "patch_quadtree.h"
+#include "grass_math.h"
+
+#include <algorithm>
+
+namespace
+{
+	/**
+	 * \brief Nodes with at most this many patches are not split any further
+	 */
+	const int LEAF_PATCHES = 16;
+
+	/**
+	 * \brief Stops splitting patches that share a position forever
+	 */
+	const int MAX_DEPTH = 20;
+
+	/**
+	 * \brief Distance from point to the closest point of the box
+	 */
+	float distanceToBox(const glm::vec3& point, const glm::vec3& min, const glm::vec3& max)
+	{
+		return glm::length(glm::max(glm::max(min - point, point - max), glm::vec3(0.0f)));
+	}
+
+	/**
+	 * \brief Distance from point to the furthest corner of the box
+	 */
+	float farthestDistanceToBox(const glm::vec3& point, const glm::vec3& min, const glm::vec3& max)
+	{
+		return glm::length(glm::max(glm::abs(min - point), glm::abs(max - point)));
+	}
+}
+
+void PatchQuadtree::build(const std::vector<PatchBounds>& bounds)
+{
+	this->bounds = bounds;
+	nodes.clear();
+	patchOrder.resize(bounds.size());
+	for (size_t i = 0; i < bounds.size(); i++)
+	{
+		patchOrder[i] = (int)i;
+	}
+
+	if (!bounds.empty())
+	{
+		nodes.emplace_back();
+		buildNode(0, 0, (int)bounds.size(), 0);
+	}
+}
+
+void PatchQuadtree::buildNode(int nodeIndex, int first, int count, int depth)
+{
+	Node node;
+	node.first = first;
+	node.count = count;
+	if (count == 0)
+	{
+		// An empty leaf, with a box nothing intersects
+		node.min = glm::vec3(1.0f);
+		node.max = glm::vec3(-1.0f);
+		nodes[nodeIndex] = node;
+		return;
+	}
+
+	node.min = bounds[patchOrder[first]].min;
+	node.max = bounds[patchOrder[first]].max;
+	for (int i = first + 1; i < first + count; i++)
+	{
+		node.min = glm::min(node.min, bounds[patchOrder[i]].min);
+		node.max = glm::max(node.max, bounds[patchOrder[i]].max);
+	}
+
+	if (count <= LEAF_PATCHES || depth >= MAX_DEPTH)
+	{
+		nodes[nodeIndex] = node;
+		return;
+	}
+
+	// Split into quadrants around the middle of the node, by the centers of
+	// the patches
+	glm::vec3 middle = (node.min + node.max) * 0.5f;
+	auto centerX = [&](int patch) { return (bounds[patch].min.x + bounds[patch].max.x) * 0.5f; };
+	auto centerZ = [&](int patch) { return (bounds[patch].min.z + bounds[patch].max.z) * 0.5f; };
+
+	int* begin = patchOrder.data() + first;
+	int* end = begin + count;
+	int* splitX = std::partition(begin, end, [&](int patch) { return centerX(patch) < middle.x; });
+	int* splitLow = std::partition(begin, splitX, [&](int patch) { return centerZ(patch) < middle.z; });
+	int* splitHigh = std::partition(splitX, end, [&](int patch) { return centerZ(patch) < middle.z; });
+	int* splits[5] = { begin, splitLow, splitX, splitHigh, end };
+
+	// The four children are consecutive
+	node.firstChild = (int)nodes.size();
+	nodes[nodeIndex] = node;
+	nodes.resize(nodes.size() + 4);
+	for (int child = 0; child < 4; child++)
+	{
+		buildNode(node.firstChild + child, (int)(splits[child] - patchOrder.data()),
+			(int)(splits[child + 1] - splits[child]), depth + 1);
+	}
+}
+
+void PatchQuadtree::query(const Frustum& frustum, const glm::vec3& cameraPosition, float maxDistance, float margin,
+	std::vector<int>& visible) const
+{
+	nodesVisited = 0;
+	if (!nodes.empty())
+	{
+		queryNode(0, frustum, cameraPosition, maxDistance, margin, visible);
+	}
+}
+
+void PatchQuadtree::queryNode(int nodeIndex, const Frustum& frustum, const glm::vec3& cameraPosition,
+	float maxDistance, float margin, std::vector<int>& visible) const
+{
+	const Node& node = nodes[nodeIndex];
+	nodesVisited++;
+	if (node.count == 0)
+		return;
+
+	glm::vec3 grow = { margin, 0.0f, margin };
+	glm::vec3 min = node.min - grow;
+	glm::vec3 max = node.max + grow;
+
+	if (distanceToBox(cameraPosition, min, max) > maxDistance || !frustum.intersectsBox(min, max))
+		return;
+
+	// Everything below is visible, no need to look any closer
+	if (farthestDistanceToBox(cameraPosition, min, max) <= maxDistance && frustum.containsBox(min, max))
+	{
+		visible.insert(visible.end(), patchOrder.begin() + node.first, patchOrder.begin() + node.first + node.count);
+		return;
+	}
+
+	if (node.firstChild < 0)
+	{
+		for (int i = node.first; i < node.first + node.count; i++)
+		{
+			int patch = patchOrder[i];
+			glm::vec3 patchMin = bounds[patch].min - grow;
+			glm::vec3 patchMax = bounds[patch].max + grow;
+			if (distanceToBox(cameraPosition, patchMin, patchMax) <= maxDistance &&
+				frustum.intersectsBox(patchMin, patchMax))
+			{
+				visible.push_back(patch);
+			}
+		}
+		return;
+	}
+
+	for (int child = 0; child < 4; child++)
+	{
+		queryNode(node.firstChild + child, frustum, cameraPosition, maxDistance, margin, visible);
+	}
+}
+
+int PatchQuadtree::getNodesVisited() const
+{
+	return nodesVisited;
+}
+
+size_t PatchQuadtree::getNodeCount() const
+{
+	return nodes.size();
+}
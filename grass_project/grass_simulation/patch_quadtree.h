@@ -0,0 +1,81 @@
+#ifndef PATCH_QUADTREE_H
+#define PATCH_QUADTREE_H
+
+#include <glm/glm.hpp>
+#include <vector>
+
+struct Frustum;
+
+/**
+ * \brief Axis aligned bounding box of a patch and the blades on it
+ */
+struct PatchBounds
+{
+	glm::vec3 min;
+	glm::vec3 max;
+};
+
+/**
+ * \brief A quadtree over the bounds of the patches, to find the visible
+ * patches without testing every single one of them.
+ * Nodes that are entirely outside the frustum or out of reach are skipped
+ * with all their patches, nodes that are entirely inside are taken without
+ * testing their patches.
+ */
+class PatchQuadtree
+{
+public:
+	/**
+	 * \brief Rebuilds the tree over bounds, one entry per patch.
+	 */
+	void build(const std::vector<PatchBounds>& bounds);
+
+	/**
+	 * \brief Appends the indices of the patches that intersect frustum and
+	 * are at most maxDistance away from cameraPosition to visible.
+	 * \param margin Grows every box by this much in x and z, for blades that
+	 * sway out of their patch.
+	 */
+	void query(const Frustum& frustum, const glm::vec3& cameraPosition, float maxDistance, float margin,
+		std::vector<int>& visible) const;
+
+	/**
+	 * \brief Nodes the last query tested
+	 */
+	int getNodesVisited() const;
+
+	size_t getNodeCount() const;
+
+private:
+	struct Node
+	{
+		glm::vec3 min;
+		glm::vec3 max;
+		// Index of the first of four consecutive children, -1 for leaves
+		int firstChild = -1;
+		// Range of patchOrder the node covers
+		int first = 0;
+		int count = 0;
+	};
+
+	/**
+	 * \brief Fills in the node at nodeIndex, covering count patches of
+	 * patchOrder from first on, and builds its children
+	 */
+	void buildNode(int nodeIndex, int first, int count, int depth);
+
+	void queryNode(int nodeIndex, const Frustum& frustum, const glm::vec3& cameraPosition, float maxDistance,
+		float margin, std::vector<int>& visible) const;
+
+	std::vector<Node> nodes;
+
+	/**
+	 * \brief Patch indices, ordered so that every node covers a contiguous
+	 * range
+	 */
+	std::vector<int> patchOrder;
+	std::vector<PatchBounds> bounds;
+	mutable int nodesVisited = 0;
+};
+
+#endif
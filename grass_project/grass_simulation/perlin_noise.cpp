@@ -1,59 +1,163 @@
 #include "perlin_noise.h"
 #include <stdlib.h>  
+#include <algorithm>
 
 #include "debug.h"
+#include "thread_pool.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PERLIN_NOISE_USE_SSE2
+#include <emmintrin.h>
+#endif
 
-void perlinNoise2DCPU(int nWidth, int nHeight, int nOctaves, float fBias, float* fOutput, float* fSeed)
-
+namespace
 {
-	for (int x = 0; x < nWidth; x++)
+	/**
+	 * \brief Rows generated per thread pool job
+	 */
+	const int PERLIN_NOISE_ROWS_PER_JOB = 16;
+
+	/**
+	 * \brief Adds one octave to a row of noise. The seed rows above and below
+	 * the row are blended by blendY, and the result is interpolated linearly
+	 * between lattice points that are 2^pitchShift pixels apart.
+	 */
+	void addOctaveToRow(float* row, const float* seedTop, const float* seedBottom, float blendY,
+		int width, int pitchShift, float weight)
 	{
-		for (int y = 0; y < nHeight; y++)
+		const int pitch = 1 << pitchShift;
+		const int mask = width - 1;
+		const float invPitch = 1.0f / (float)pitch;
+
+		for (int x1 = 0; x1 < width; x1 += pitch)
 		{
-			float fNoise = 0.0f;
-			float fScaleAcc = 0.0f;
-			float fScale = 1.0f;
+			int x2 = (x1 + pitch) & mask;
 
-			for (int o = 0; o < nOctaves; o++)
+			float sampleL = seedTop[x1] + blendY * (seedBottom[x1] - seedTop[x1]);
+			float sampleR = seedTop[x2] + blendY * (seedBottom[x2] - seedTop[x2]);
+
+			// Within a span the octave is a linear ramp
+			float start = sampleL * weight;
+			float slope = (sampleR - sampleL) * invPitch * weight;
+			float* span = row + x1;
+			int x = 0;
+
+#ifdef PERLIN_NOISE_USE_SSE2
+			// Spans are whole registers from a pitch of four up
+			if (pitch >= 4)
 			{
-				int nPitch = nWidth >> o;
-				int nSampleX1 = (x / nPitch) * nPitch;
-				int nSampleY1 = (y / nPitch) * nPitch;
+				const __m128 startV = _mm_set1_ps(start);
+				const __m128 slopeV = _mm_set1_ps(slope);
+				const __m128 fourV = _mm_set1_ps(4.0f);
+				__m128 offsets = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+
+				for (; x < pitch; x += 4)
+				{
+					__m128 value = _mm_add_ps(startV, _mm_mul_ps(offsets, slopeV));
+					_mm_storeu_ps(span + x, _mm_add_ps(_mm_loadu_ps(span + x), value));
+					offsets = _mm_add_ps(offsets, fourV);
+				}
+			}
+#endif
+
+			for (; x < pitch; x++)
+			{
+				span[x] += start + (float)x * slope;
+			}
+		}
+	}
+}
 
-				int nSampleX2 = (nSampleX1 + nPitch) % nWidth;
-				int nSampleY2 = (nSampleY1 + nPitch) % nWidth;
+void perlinNoise2DCPU(int nWidth, int nHeight, int nOctaves, float fBias, float* fOutput, float* fSeed, ThreadPool* threadPool)
+{
+	if (nWidth <= 0 || (nWidth & (nWidth - 1)) != 0)
+	{
+		LOG_ERROR("Perlin noise width has to be a power of two, but was %d", nWidth);
+		return;
+	}
 
-				float fBlendX = (float)(x - nSampleX1) / (float)nPitch;
-				float fBlendY = (float)(y - nSampleY1) / (float)nPitch;
+	int widthShift = 0;
+	while ((1 << widthShift) < nWidth)
+		widthShift++;
 
-				float fSampleT = (1.0f - fBlendX) * fSeed[nSampleY1 * nWidth + nSampleX1] + fBlendX * fSeed[nSampleY1 * nWidth + nSampleX2];
-				float fSampleB = (1.0f - fBlendX) * fSeed[nSampleY2 * nWidth + nSampleX1] + fBlendX * fSeed[nSampleY2 * nWidth + nSampleX2];
+	// Octaves finer than a pixel would have a pitch of zero
+	nOctaves = glm::clamp(nOctaves, 1, widthShift + 1);
 
-				fScaleAcc += fScale;
-				fNoise += (fBlendY * (fSampleB - fSampleT) + fSampleT) * fScale;
-				fScale = fScale / fBias;
-			}
+	// The weight of each octave, already divided by the sum of all weights
+	float fWeights[32];
+	float fScaleAcc = 0.0f;
+	float fScale = 1.0f;
+	for (int o = 0; o < nOctaves; o++)
+	{
+		fWeights[o] = fScale;
+		fScaleAcc += fScale;
+		fScale = fScale / fBias;
+	}
+	for (int o = 0; o < nOctaves; o++)
+		fWeights[o] /= fScaleAcc;
 
-			// Scale to seed range
-			fOutput[y * nWidth + x] = fNoise / fScaleAcc;
+	auto generateRows = [&](size_t begin, size_t end)
+	{
+		for (int y = (int)begin; y < (int)end; y++)
+		{
+			float* row = fOutput + (size_t)y * nWidth;
+			std::fill(row, row + nWidth, 0.0f);
+
+			for (int o = 0; o < nOctaves; o++)
+			{
+				int pitchShift = widthShift - o;
+				int nSampleY1 = (y >> pitchShift) << pitchShift;
+				int nSampleY2 = (nSampleY1 + (1 << pitchShift)) & (nWidth - 1);
+				float fBlendY = (float)(y - nSampleY1) / (float)(1 << pitchShift);
 
+				addOctaveToRow(row, fSeed + (size_t)nSampleY1 * nWidth, fSeed + (size_t)nSampleY2 * nWidth,
+					fBlendY, nWidth, pitchShift, fWeights[o]);
+			}
 		}
+	};
+
+	if (threadPool)
+	{
+		threadPool->parallelFor((size_t)nHeight, PERLIN_NOISE_ROWS_PER_JOB, generateRows);
+	}
+	else
+	{
+		generateRows(0, (size_t)nHeight);
 	}
 }
 
 
-void perlinNoise2DGPU(Texture& seedTexture, float* seedTextureData, ShaderProgram* computeShaderProgram, GLuint computeShaderTexture, int octaves, float bias) {
-	seedTexture.loadTextureData(seedTextureData, PERLIN_NOISE_TEXTURE_WIDTH, PERLIN_NOISE_TEXTURE_WIDTH, GL_RED);
+void perlinNoiseSeeds(int nWidth, uint32_t seed, float* fSeed)
+{
+	// Has to match lattice_value in perlin_noise.comp
+	for (int y = 0; y < nWidth; y++)
+	{
+		for (int x = 0; x < nWidth; x++)
+		{
+			uint32_t h = (uint32_t)x * 0x8DA6B343u + (uint32_t)y * 0xD8163841u + seed * 0xCB1AB31Fu;
+			h ^= h >> 16;
+			h *= 0x7FEB352Du;
+			h ^= h >> 15;
+			h *= 0x846CA68Bu;
+			h ^= h >> 16;
+			fSeed[(size_t)y * nWidth + x] = (float)(h >> 8) * (1.0f / 16777216.0f);
+		}
+	}
+}
+
+void perlinNoise2DGPU(ShaderProgram* computeShaderProgram, GLuint computeShaderTexture, int octaves, float bias, uint32_t seed) {
+	int widthShift = 0;
+	while ((1 << widthShift) < PERLIN_NOISE_TEXTURE_WIDTH)
+		widthShift++;
 
 	computeShaderProgram->use();
 
 	GLCall(glBindImageTexture(0, computeShaderTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R8));
-	GLCall(glBindImageTexture(1, seedTexture.getTextureID(), 0, GL_FALSE, 0,  GL_READ_ONLY, GL_R8));
 
 	computeShaderProgram->setInt("width", PERLIN_NOISE_TEXTURE_WIDTH);
-	computeShaderProgram->setInt("octaves", octaves);
+	computeShaderProgram->setInt("octaves", glm::clamp(octaves, 1, widthShift + 1));
 	computeShaderProgram->setFloat("bias", bias);
+	computeShaderProgram->setUint("seed", seed);
 	
 	GLCall(glDispatchCompute(PERLIN_NOISE_TEXTURE_WIDTH / 16, PERLIN_NOISE_TEXTURE_WIDTH / 16, 1));
-}
\ No newline at end of file
+}
@@ -6,6 +6,21 @@
 #include "rendering/texture.h"
 #include "rendering/shader_program.h"
 
+class ThreadPool;
+
+/**
+* Represents how the wind noise is generated
+*
+* VALUE_NOISE:		Interpolates random values hashed from the lattice points,
+*					see perlinNoiseSeeds.
+* GRADIENT_NOISE:	Gradient noise from a hashed lattice, without a seed
+*					texture. See gradient_noise.h.
+*/
+enum class NoiseGenerator {
+	VALUE_NOISE,
+	GRADIENT_NOISE
+};
+
 /**
 * Settings the user can use to manipulate the generated perlin noise.
 * makeChecker :			If set to true no perlin noise will be generated and a
@@ -15,21 +30,43 @@
 * textureScale:	Dictates the sample scale used to sample the
 *						perlin noise texture. Effectively zooming in and
 *						out on the texture.
+* generateOnCPU:	Generates the noise on the CPU and uploads it, for when
+*						compute shaders are not available.
+* seed			:	Seed of the lattice values of both generators.
+* streaming	:	Scrolls through non-repeating gradient noise, generating
+*						only what the wind moves into view, instead of
+*						repeating one texture. See streaming_noise.h.
 */
 struct PerlinConfig {
 	int octaves = 6;
 	float bias = 1.0f;
+	bool generateOnCPU = false;
+	NoiseGenerator generator = NoiseGenerator::GRADIENT_NOISE;
+	uint32_t seed = 1;
+	bool streaming = false;
 	Texture* texture = nullptr;
 };
 
 /**
-* Generates perlin noise on the CPU.
+* Generates perlin noise on the CPU, row by row. nWidth has to be a power of
+* two and fSeed has to hold nWidth x nWidth values.
+* \param threadPool Splits the rows between its threads. Generates on the
+* calling thread if nullptr.
+*/
+void perlinNoise2DCPU(int nWidth, int nHeight, int nOctaves, float fBias, float* fOutput, float* fSeed,
+	ThreadPool* threadPool = nullptr);
+
+/**
+* Fills fSeed with the nWidth x nWidth lattice values of seed, the same values
+* perlinNoise2DGPU hashes on the GPU. nWidth has to be a power of two.
 */
-void perlinNoise2DCPU(int nWidth, int nHeight, int nOctaves, float fBias, float* fOutput, float* fSeed);
+void perlinNoiseSeeds(int nWidth, uint32_t seed, float* fSeed);
 
 /**
-* Generates perlin noise on the GPU.
+* Generates perlin noise on the GPU, into a PERLIN_NOISE_TEXTURE_WIDTH wide
+* single channel image texture. The lattice values are hashed from seed on the
+* GPU, so nothing is uploaded.
 */
-void perlinNoise2DGPU(Texture& seedTexture, float* seedTextureData, ShaderProgram* computeShaderProgram, GLuint computeShaderTexture, int octaves, float bias);
+void perlinNoise2DGPU(ShaderProgram* computeShaderProgram, GLuint computeShaderTexture, int octaves, float bias, uint32_t seed);
 
 #endif
\ No newline at end of file
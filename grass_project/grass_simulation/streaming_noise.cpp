@@ -0,0 +1,140 @@
+#include "streaming_noise.h"
+#include "rendering/texture.h"
+
+#include <cstdlib>
+
+StreamingNoise::StreamingNoise(int width)
+	: width(width)
+{
+	settings.pitch = width;
+	settings.period = 0;
+
+	texture = new Texture("Streaming Noise", GL_TEXTURE_2D);
+	texture->loadTextureSingleChannel(width);
+
+	uploadData = new float[(size_t)width * width];
+}
+
+StreamingNoise::~StreamingNoise()
+{
+	delete texture;
+	delete[] uploadData;
+}
+
+void StreamingNoise::setSettings(const GradientNoiseSettings& newSettings)
+{
+	GradientNoiseSettings streamed = newSettings;
+	streamed.period = 0;
+
+	if (streamed.octaves != settings.octaves || streamed.bias != settings.bias ||
+		streamed.seed != settings.seed || streamed.pitch != settings.pitch)
+	{
+		settings = streamed;
+		valid = false;
+	}
+}
+
+void StreamingNoise::invalidate()
+{
+	valid = false;
+}
+
+void StreamingNoise::update(glm::vec2 offset, ShaderProgram* computeShaderProgram, ThreadPool* threadPool)
+{
+	glm::ivec2 newOrigin = glm::ivec2(glm::floor(offset * (float)width));
+	glm::ivec2 delta = newOrigin - origin;
+	generatedPixels = 0;
+
+	if (!valid || std::abs(delta.x) >= width || std::abs(delta.y) >= width)
+	{
+		generate(newOrigin.x, newOrigin.y, width, width, computeShaderProgram, threadPool);
+	}
+	else
+	{
+		// Columns that came into view, over every row of the new window
+		if (delta.x > 0)
+			generate(origin.x + width, newOrigin.y, delta.x, width, computeShaderProgram, threadPool);
+		else if (delta.x < 0)
+			generate(newOrigin.x, newOrigin.y, -delta.x, width, computeShaderProgram, threadPool);
+
+		// Rows that came into view, without the columns that were just generated
+		int keptX = delta.x > 0 ? newOrigin.x : origin.x;
+		int keptWidth = width - std::abs(delta.x);
+		if (delta.y > 0)
+			generate(keptX, origin.y + width, keptWidth, delta.y, computeShaderProgram, threadPool);
+		else if (delta.y < 0)
+			generate(keptX, newOrigin.y, keptWidth, -delta.y, computeShaderProgram, threadPool);
+	}
+
+	origin = newOrigin;
+	valid = true;
+
+	if (computeShaderProgram && generatedPixels > 0)
+	{
+		// The texture is sampled right after, in this frame's draws
+		GLCall(glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT));
+	}
+}
+
+void StreamingNoise::generate(int x, int y, int generateWidth, int generateHeight,
+	ShaderProgram* computeShaderProgram, ThreadPool* threadPool)
+{
+	if (generateWidth <= 0 || generateHeight <= 0)
+		return;
+
+	generatedPixels += generateWidth * generateHeight;
+
+	if (computeShaderProgram)
+	{
+		// The compute shader wraps the pixels around the texture itself
+		gradientNoise2DGPU(settings, x, y, generateWidth, generateHeight, computeShaderProgram, texture->getTextureID());
+	}
+	else
+	{
+		gradientNoise2DCPU(settings, x, y, generateWidth, generateHeight, uploadData, threadPool);
+		upload(x, y, generateWidth, generateHeight, uploadData);
+	}
+}
+
+void StreamingNoise::upload(int x, int y, int uploadWidth, int uploadHeight, const float* generated)
+{
+	const int mask = width - 1;
+
+	texture->bind();
+	GLCall(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+	GLCall(glPixelStorei(GL_UNPACK_ROW_LENGTH, uploadWidth));
+
+	// At most four pieces, split where the rectangle wraps around the edges
+	for (int row = 0; row < uploadHeight;)
+	{
+		int textureY = (y + row) & mask;
+		int rows = glm::min(uploadHeight - row, width - textureY);
+
+		for (int column = 0; column < uploadWidth;)
+		{
+			int textureX = (x + column) & mask;
+			int columns = glm::min(uploadWidth - column, width - textureX);
+
+			GLCall(glPixelStorei(GL_UNPACK_SKIP_PIXELS, column));
+			GLCall(glPixelStorei(GL_UNPACK_SKIP_ROWS, row));
+			GLCall(glTexSubImage2D(GL_TEXTURE_2D, 0, textureX, textureY, columns, rows, GL_RED, GL_FLOAT, generated));
+
+			column += columns;
+		}
+		row += rows;
+	}
+
+	GLCall(glPixelStorei(GL_UNPACK_ROW_LENGTH, 0));
+	GLCall(glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0));
+	GLCall(glPixelStorei(GL_UNPACK_SKIP_ROWS, 0));
+}
+
+Texture* StreamingNoise::getTexture()
+{
+	return texture;
+}
+
+int StreamingNoise::getGeneratedPixels() const
+{
+	return generatedPixels;
+}
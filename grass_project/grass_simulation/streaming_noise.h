@@ -0,0 +1,89 @@
+#ifndef STREAMING_NOISE_H
+#define STREAMING_NOISE_H
+
+#include <glm/glm.hpp>
+
+#include "gradient_noise.h"
+
+class Texture;
+class ThreadPool;
+
+/**
+ * \brief A window onto non-repeating gradient noise that follows the wind
+ * offset. The window is kept in a toroidal texture: pixel (x, y) of the noise
+ * plane lives at (x, y) modulo the texture size. When the window moves, only
+ * the rows and columns that came into view are generated, so the noise never
+ * repeats and scrolling costs a few rows per frame instead of a whole texture.
+ * Sample the texture with GL_REPEAT at the same offset the window follows.
+ */
+class StreamingNoise
+{
+public:
+	/**
+	 * \param width Size of the texture, a power of two.
+	 */
+	explicit StreamingNoise(int width);
+	~StreamingNoise();
+
+	StreamingNoise(const StreamingNoise&) = delete;
+	StreamingNoise& operator=(const StreamingNoise&) = delete;
+
+	/**
+	 * \brief Changes the noise. The period is ignored, the noise never
+	 * repeats. Regenerates the whole window on the next update if anything
+	 * changed.
+	 */
+	void setSettings(const GradientNoiseSettings& settings);
+
+	/**
+	 * \brief Moves the window to offset, in texture widths, and generates what
+	 * came into view.
+	 * \param computeShaderProgram Generates on the GPU, created for the
+	 * octaves of the settings. Generates on the CPU and uploads if nullptr.
+	 * \param threadPool Splits CPU generation between its threads, may be nullptr.
+	 */
+	void update(glm::vec2 offset, ShaderProgram* computeShaderProgram, ThreadPool* threadPool);
+
+	/**
+	 * \brief Forces the whole window to be generated on the next update.
+	 */
+	void invalidate();
+
+	Texture* getTexture();
+
+	/**
+	 * \brief Pixels generated by the last update.
+	 */
+	int getGeneratedPixels() const;
+
+private:
+	/**
+	 * \brief Generates the pixels [x, x + width) x [y, y + height) of the
+	 * noise plane into the texture.
+	 */
+	void generate(int x, int y, int width, int height, ShaderProgram* computeShaderProgram, ThreadPool* threadPool);
+
+	/**
+	 * \brief Uploads width x height pixels of generated, whose top left is
+	 * pixel (x, y) of the noise plane, wrapping around the texture edges.
+	 */
+	void upload(int x, int y, int width, int height, const float* generated);
+
+	int width = 0;
+	GradientNoiseSettings settings;
+	Texture* texture = nullptr;
+
+	/**
+	 * \brief Noise plane pixel at the top left of the window
+	 */
+	glm::ivec2 origin = { 0, 0 };
+	bool valid = false;
+	int generatedPixels = 0;
+
+	/**
+	 * \brief Generated pixels waiting for upload, when generating on the CPU
+	 */
+	float* uploadData = nullptr;
+};
+
+#endif
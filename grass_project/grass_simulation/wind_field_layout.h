@@ -0,0 +1,84 @@
+#ifndef WIND_FIELD_LAYOUT_H
+#define WIND_FIELD_LAYOUT_H
+
+/*
+ * Layout of the shared memory the live wind field is published to. This
+ * header has no dependencies, so other processes can include it to read the
+ * wind field, see wind_field_reader for an example.
+ */
+
+#include <atomic>
+#include <cstdint>
+
+#ifdef _WIN32
+#define WIND_FIELD_SHARED_MEMORY_NAME "Local\\GrassProjectWindField"
+#else
+#define WIND_FIELD_SHARED_MEMORY_NAME "/grass_project_wind_field"
+#endif
+
+const uint32_t WIND_FIELD_MAGIC = 0x444E4957; // "WIND"
+const uint32_t WIND_FIELD_VERSION = 1;
+
+/**
+ * \brief Number of frames kept in the ring. A reader has this many frames of
+ * time to read a frame before the publisher overwrites it.
+ */
+const uint32_t WIND_FIELD_RING_SLOTS = 4;
+
+/**
+ * \brief Start of the shared memory.
+ * closed:			Set when the publisher goes away. Readers should unmap
+ *					and open the shared memory again, the resolution may
+ *					have changed.
+ * latestFrameId:	Id of the newest complete frame, it lives in slot
+ *					latestFrameId % slotCount. Zero until the first frame.
+ */
+struct WindFieldSharedHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t slotCount;
+	uint32_t resolution;
+	uint64_t slotOffset;
+	uint64_t slotStride;
+	std::atomic<uint32_t> closed;
+	std::atomic<uint64_t> latestFrameId;
+};
+
+/**
+ * \brief Start of a ring slot, followed by the density, velocity x and
+ * velocity y fields as resolution x resolution floats, in that order.
+ *
+ * The slot is guarded by a seqlock: sequence is odd while the publisher
+ * writes the slot. Readers read sequence, read the fields in place, then read
+ * sequence again. The frame is consistent if both reads are the same even
+ * value, otherwise it was overwritten and should be read again.
+ */
+struct alignas(64) WindFieldSlotHeader
+{
+	std::atomic<uint32_t> sequence;
+	uint32_t resolution;
+	uint64_t frameId;
+	uint64_t timestampNanoseconds;
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "The wind field needs lock free atomics");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "The wind field needs lock free atomics");
+
+inline uint64_t windFieldSlotOffset()
+{
+	return (sizeof(WindFieldSharedHeader) + 63) / 64 * 64;
+}
+
+inline uint64_t windFieldSlotStride(uint32_t resolution)
+{
+	uint64_t fieldsSize = 3ull * resolution * resolution * sizeof(float);
+	return (sizeof(WindFieldSlotHeader) + fieldsSize + 63) / 64 * 64;
+}
+
+inline uint64_t windFieldSharedMemorySize(uint32_t resolution)
+{
+	return windFieldSlotOffset() + WIND_FIELD_RING_SLOTS * windFieldSlotStride(resolution);
+}
+
+#endif
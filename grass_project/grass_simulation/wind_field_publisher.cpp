@@ -0,0 +1,224 @@
+#include "wind_field_publisher.h"
+#include "logger.h"
+
+#include <chrono>
+#include <cstring>
+
+#ifdef _WIN32
+#define NOGDI
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifndef _WIN32
+/**
+ * \brief Whether the existing shared memory was closed by its publisher, or
+ * is not a wind field at all
+ */
+static bool isSharedMemoryAbandoned()
+{
+	int file = shm_open(WIND_FIELD_SHARED_MEMORY_NAME, O_RDONLY, 0);
+	if (file < 0)
+		return true;
+
+	struct stat fileStat;
+	if (fstat(file, &fileStat) != 0 || (size_t)fileStat.st_size < sizeof(WindFieldSharedHeader))
+	{
+		::close(file);
+		return true;
+	}
+
+	void* view = mmap(nullptr, sizeof(WindFieldSharedHeader), PROT_READ, MAP_SHARED, file, 0);
+	::close(file);
+	if (view == MAP_FAILED)
+		return false;
+
+	const WindFieldSharedHeader* header = (const WindFieldSharedHeader*)view;
+	bool abandoned = header->magic != WIND_FIELD_MAGIC || header->closed.load(std::memory_order_acquire);
+	munmap(view, sizeof(WindFieldSharedHeader));
+	return abandoned;
+}
+#endif
+
+WindFieldPublisher::~WindFieldPublisher()
+{
+	close();
+}
+
+bool WindFieldPublisher::open(uint32_t resolution)
+{
+	close();
+
+	uint64_t size = windFieldSharedMemorySize(resolution);
+
+#ifdef _WIN32
+	HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+		(DWORD)(size >> 32), (DWORD)size, WIND_FIELD_SHARED_MEMORY_NAME);
+	if (!mapping)
+	{
+		LOG_ERROR("Could not create shared memory '%s'", WIND_FIELD_SHARED_MEMORY_NAME);
+		return false;
+	}
+
+	// A reader that still has the memory of an earlier open mapped keeps it
+	// alive, and the old section is returned at its old size
+	bool existing = GetLastError() == ERROR_ALREADY_EXISTS;
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, existing ? 0 : (SIZE_T)size);
+	if (!view)
+	{
+		LOG_ERROR("Could not map shared memory '%s'", WIND_FIELD_SHARED_MEMORY_NAME);
+		CloseHandle(mapping);
+		return false;
+	}
+
+	MEMORY_BASIC_INFORMATION viewInfo;
+	if (existing && (!VirtualQuery(view, &viewInfo, sizeof(viewInfo)) || viewInfo.RegionSize < size))
+	{
+		LOG_ERROR("A reader keeps the old shared memory '%s' alive, too small for %ux%u fields, close it to publish",
+			WIND_FIELD_SHARED_MEMORY_NAME, resolution, resolution);
+		UnmapViewOfFile(view);
+		CloseHandle(mapping);
+		return false;
+	}
+	mappingHandle = mapping;
+#else
+	int file = shm_open(WIND_FIELD_SHARED_MEMORY_NAME, O_CREAT | O_EXCL | O_RDWR, 0644);
+	if (file < 0 && errno == EEXIST)
+	{
+		// Only take the memory over if no publisher uses it anymore
+		if (!isSharedMemoryAbandoned())
+		{
+			LOG_ERROR("Shared memory '%s' belongs to another publisher, remove it if that one crashed",
+				WIND_FIELD_SHARED_MEMORY_NAME);
+			return false;
+		}
+		shm_unlink(WIND_FIELD_SHARED_MEMORY_NAME);
+		file = shm_open(WIND_FIELD_SHARED_MEMORY_NAME, O_CREAT | O_EXCL | O_RDWR, 0644);
+	}
+	if (file < 0)
+	{
+		LOG_ERROR("Could not create shared memory '%s'", WIND_FIELD_SHARED_MEMORY_NAME);
+		return false;
+	}
+
+	if (ftruncate(file, (off_t)size) != 0)
+	{
+		LOG_ERROR("Could not size shared memory '%s'", WIND_FIELD_SHARED_MEMORY_NAME);
+		::close(file);
+		shm_unlink(WIND_FIELD_SHARED_MEMORY_NAME);
+		return false;
+	}
+
+	void* view = mmap(nullptr, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	::close(file);
+	if (view == MAP_FAILED)
+	{
+		LOG_ERROR("Could not map shared memory '%s'", WIND_FIELD_SHARED_MEMORY_NAME);
+		shm_unlink(WIND_FIELD_SHARED_MEMORY_NAME);
+		return false;
+	}
+#endif
+
+	memory = (unsigned char*)view;
+	memorySize = size;
+
+	// Fresh shared memory is zeroed, so every slot sequence starts out even.
+	// Memory a reader kept alive was left even when it was closed.
+	WindFieldSharedHeader* header = getHeader();
+	header->magic = WIND_FIELD_MAGIC;
+	header->version = WIND_FIELD_VERSION;
+	header->slotCount = WIND_FIELD_RING_SLOTS;
+	header->resolution = resolution;
+	header->slotOffset = windFieldSlotOffset();
+	header->slotStride = windFieldSlotStride(resolution);
+	header->closed.store(0, std::memory_order_relaxed);
+	header->latestFrameId.store(0, std::memory_order_release);
+
+	LOG_INFO("Publishing the %ux%u wind field to shared memory '%s'", resolution, resolution, WIND_FIELD_SHARED_MEMORY_NAME);
+	return true;
+}
+
+void WindFieldPublisher::close()
+{
+	if (!memory)
+		return;
+
+	getHeader()->closed.store(1, std::memory_order_release);
+
+#ifdef _WIN32
+	UnmapViewOfFile(memory);
+	CloseHandle(mappingHandle);
+	mappingHandle = nullptr;
+#else
+	munmap(memory, (size_t)memorySize);
+	shm_unlink(WIND_FIELD_SHARED_MEMORY_NAME);
+#endif
+
+	memory = nullptr;
+	memorySize = 0;
+}
+
+bool WindFieldPublisher::isOpen() const
+{
+	return memory != nullptr;
+}
+
+void WindFieldPublisher::publish(const float* density, const float* velX, const float* velY, uint32_t resolution)
+{
+	if (!memory || getHeader()->resolution != resolution)
+	{
+		auto now = std::chrono::steady_clock::now();
+		if (!memory && resolution == failedResolution && now < retryTime)
+			return;
+
+		if (!open(resolution))
+		{
+			failedResolution = resolution;
+			retryTime = now + WIND_FIELD_RETRY_DELAY;
+			return;
+		}
+		failedResolution = 0;
+	}
+
+	WindFieldSharedHeader* header = getHeader();
+
+	frameId++;
+	uint64_t slotIndex = frameId % header->slotCount;
+	WindFieldSlotHeader* slot = (WindFieldSlotHeader*)(memory + header->slotOffset + slotIndex * header->slotStride);
+
+	// Odd sequence: readers of this slot will retry
+	uint32_t sequence = slot->sequence.load(std::memory_order_relaxed);
+	slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	slot->resolution = resolution;
+	slot->frameId = frameId;
+	slot->timestampNanoseconds = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+
+	size_t fieldSize = (size_t)resolution * resolution;
+	float* fields = (float*)(slot + 1);
+	memcpy(fields, density, fieldSize * sizeof(float));
+	memcpy(fields + fieldSize, velX, fieldSize * sizeof(float));
+	memcpy(fields + 2 * fieldSize, velY, fieldSize * sizeof(float));
+
+	slot->sequence.store(sequence + 2, std::memory_order_release);
+	header->latestFrameId.store(frameId, std::memory_order_release);
+}
+
+uint64_t WindFieldPublisher::getFrameId() const
+{
+	return frameId;
+}
+
+WindFieldSharedHeader* WindFieldPublisher::getHeader()
+{
+	return (WindFieldSharedHeader*)memory;
+}
@@ -0,0 +1,68 @@
+#ifndef WIND_FIELD_PUBLISHER_H
+#define WIND_FIELD_PUBLISHER_H
+
+#include <chrono>
+#include <cstdint>
+
+#include "wind_field_layout.h"
+
+/**
+ * \brief Time publish waits before it opens the shared memory again after it
+ * failed to
+ */
+const std::chrono::seconds WIND_FIELD_RETRY_DELAY(5);
+
+/**
+ * \brief Publishes wind field frames to a shared memory ring buffer, laid out
+ * as described in wind_field_layout.h. Publishing never waits for readers.
+ */
+class WindFieldPublisher
+{
+public:
+	WindFieldPublisher() = default;
+
+	/**
+	 * \brief Marks the shared memory closed and unmaps it.
+	 */
+	~WindFieldPublisher();
+
+	WindFieldPublisher(const WindFieldPublisher&) = delete;
+	WindFieldPublisher& operator=(const WindFieldPublisher&) = delete;
+
+	/**
+	 * \brief Creates the shared memory for resolution x resolution fields.
+	 * \return True if the shared memory could be created.
+	 */
+	bool open(uint32_t resolution);
+	void close();
+	bool isOpen() const;
+
+	/**
+	 * \brief Writes a frame into the next ring slot. Reopens the shared
+	 * memory if the resolution changed. After a failed open, only tries
+	 * again once the resolution changes or WIND_FIELD_RETRY_DELAY passed.
+	 */
+	void publish(const float* density, const float* velX, const float* velY, uint32_t resolution);
+
+	uint64_t getFrameId() const;
+
+private:
+	unsigned char* memory = nullptr;
+	uint64_t memorySize = 0;
+	uint64_t frameId = 0;
+
+	/**
+	 * \brief Resolution of the last open that failed, and when publish may
+	 * try it again
+	 */
+	uint32_t failedResolution = 0;
+	std::chrono::steady_clock::time_point retryTime;
+
+#ifdef _WIN32
+	void* mappingHandle = nullptr;
+#endif
+
+	WindFieldSharedHeader* getHeader();
+};
+
+#endif
@@ -0,0 +1,273 @@
+#include "wind_flipbook.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	const char WIND_FLIPBOOK_MAGIC[4] = { 'W', 'F', 'L', 'B' };
+	const uint32_t WIND_FLIPBOOK_VERSION = 1;
+
+	/**
+	 * \brief Number of fields stored per frame: density, velX and velY.
+	 */
+	const int WIND_FLIPBOOK_FIELDS = 3;
+
+	/**
+	 * \brief Largest resolution a flipbook may have, the largest fluid grid
+	 * snapshot with its border. Anything larger is taken for a corrupt header.
+	 */
+	const uint32_t WIND_FLIPBOOK_MAX_RESOLUTION = 4096 + 2;
+
+	/**
+	 * \brief Dequantizes two frames of a field and blends between them.
+	 */
+	void dequantizeBlended(const int8_t* a, const int8_t* b, float blend, float scale, size_t count, float* output)
+	{
+		float scaleA = (1.0f - blend) * scale / 127.0f;
+		float scaleB = blend * scale / 127.0f;
+		for (size_t i = 0; i < count; i++)
+		{
+			output[i] = a[i] * scaleA + b[i] * scaleB;
+		}
+	}
+}
+
+bool WindFlipbook::bake(const std::string& path, const WindFlipbookBakeSettings& settings, const std::vector<Fan>& fans)
+{
+	if (settings.N <= 0 || settings.framesPerSecond <= 0 || settings.seconds <= 0.0f)
+	{
+		LOG_ERROR("Invalid flipbook bake settings, N = %d, fps = %d, seconds = %.2f",
+			settings.N, settings.framesPerSecond, settings.seconds);
+		return false;
+	}
+
+	float deltaTime = 1.0f / (float)settings.framesPerSecond;
+	int warmupFrames = (int)(settings.warmupSeconds * settings.framesPerSecond);
+	int loopFrames = std::max(1, (int)(settings.seconds * settings.framesPerSecond));
+	int fadeFrames = std::clamp((int)(settings.crossfadeSeconds * settings.framesPerSecond), 0, loopFrames);
+
+	int resolution = settings.N + 2;
+	size_t fieldSize = (size_t)resolution * resolution;
+	size_t frameSize = WIND_FLIPBOOK_FIELDS * fieldSize;
+
+	FluidGrid fluidGrid(settings.N, settings.diffusion, settings.viscosity, nullptr);
+	auto step = [&]()
+	{
+		fluidGrid.clearCurrent();
+		fluidGrid.applyFans(fans);
+		fluidGrid.simulate(deltaTime);
+	};
+
+	for (int frame = 0; frame < warmupFrames; frame++)
+	{
+		step();
+	}
+
+	// Record the loop, plus the tail that gets faded into the start of the loop
+	std::vector<float> recording((size_t)(loopFrames + fadeFrames) * frameSize);
+	for (int frame = 0; frame < loopFrames + fadeFrames; frame++)
+	{
+		step();
+
+		float* destination = &recording[frame * frameSize];
+		memcpy(destination, fluidGrid.getDensity(), fieldSize * sizeof(float));
+		memcpy(destination + fieldSize, fluidGrid.getVelX(), fieldSize * sizeof(float));
+		memcpy(destination + 2 * fieldSize, fluidGrid.getVelY(), fieldSize * sizeof(float));
+	}
+
+	// The first frames blend from the continuation of the last frame into the
+	// start, so playback wraps around without a visible jump.
+	for (int frame = 0; frame < fadeFrames; frame++)
+	{
+		float blend = (float)(frame + 1) / (float)(fadeFrames + 1);
+		float* head = &recording[frame * frameSize];
+		const float* tail = &recording[(loopFrames + frame) * frameSize];
+		for (size_t i = 0; i < frameSize; i++)
+		{
+			head[i] = tail[i] + (head[i] - tail[i]) * blend;
+		}
+	}
+
+	// Every field is quantized with its own scale
+	float scales[WIND_FLIPBOOK_FIELDS] = {};
+	for (int frame = 0; frame < loopFrames; frame++)
+	{
+		for (int field = 0; field < WIND_FLIPBOOK_FIELDS; field++)
+		{
+			const float* values = &recording[frame * frameSize + field * fieldSize];
+			for (size_t i = 0; i < fieldSize; i++)
+			{
+				scales[field] = std::max(scales[field], std::abs(values[i]));
+			}
+		}
+	}
+	for (float& scale : scales)
+	{
+		if (scale == 0.0f)
+			scale = 1.0f;
+	}
+
+	FILE* file = fopen(path.c_str(), "wb");
+	if (!file)
+	{
+		LOG_ERROR("Could not open '%s' for writing the flipbook", path.c_str());
+		return false;
+	}
+
+	WindFlipbookHeader header{};
+	memcpy(header.magic, WIND_FLIPBOOK_MAGIC, sizeof(header.magic));
+	header.version = WIND_FLIPBOOK_VERSION;
+	header.resolution = (uint32_t)resolution;
+	header.frameCount = (uint32_t)loopFrames;
+	header.framesPerSecond = (float)settings.framesPerSecond;
+	header.densityScale = scales[0];
+	header.velXScale = scales[1];
+	header.velYScale = scales[2];
+
+	bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+
+	std::vector<int8_t> quantized(frameSize);
+	for (int frame = 0; frame < loopFrames && success; frame++)
+	{
+		const float* values = &recording[frame * frameSize];
+		for (size_t i = 0; i < frameSize; i++)
+		{
+			float scale = scales[i / fieldSize];
+			quantized[i] = (int8_t)std::lround(std::clamp(values[i] / scale, -1.0f, 1.0f) * 127.0f);
+		}
+		success = fwrite(quantized.data(), 1, frameSize, file) == frameSize;
+	}
+
+	fclose(file);
+
+	if (!success)
+	{
+		LOG_ERROR("Failed writing the flipbook to '%s'", path.c_str());
+		return false;
+	}
+
+	LOG_INFO("Baked %d wind frames of %dx%d to '%s'", loopFrames, resolution, resolution, path.c_str());
+	return true;
+}
+
+bool WindFlipbook::open(const std::string& path)
+{
+	close();
+
+	if (!file.open(path))
+		return false;
+
+	if (file.size() < sizeof(WindFlipbookHeader))
+	{
+		LOG_ERROR("'%s' is too small to be a flipbook", path.c_str());
+		close();
+		return false;
+	}
+
+	const WindFlipbookHeader* candidate = (const WindFlipbookHeader*)file.data();
+	if (memcmp(candidate->magic, WIND_FLIPBOOK_MAGIC, sizeof(candidate->magic)) != 0 ||
+		candidate->version != WIND_FLIPBOOK_VERSION)
+	{
+		LOG_ERROR("'%s' is not a version %u flipbook", path.c_str(), WIND_FLIPBOOK_VERSION);
+		close();
+		return false;
+	}
+
+	// Bounded first, so the sizes below cannot overflow 64 bits and play can
+	// count frames in an int
+	if (candidate->resolution == 0 || candidate->resolution > WIND_FLIPBOOK_MAX_RESOLUTION ||
+		candidate->frameCount == 0 || candidate->frameCount > (uint32_t)INT_MAX ||
+		!std::isfinite(candidate->framesPerSecond) || candidate->framesPerSecond <= 0.0f)
+	{
+		LOG_ERROR("Flipbook '%s' has a corrupt header", path.c_str());
+		close();
+		return false;
+	}
+
+	uint64_t fieldSize = (uint64_t)candidate->resolution * candidate->resolution;
+	uint64_t framesSize = (uint64_t)candidate->frameCount * WIND_FLIPBOOK_FIELDS * fieldSize;
+	if ((uint64_t)file.size() - sizeof(WindFlipbookHeader) < framesSize)
+	{
+		LOG_ERROR("Flipbook '%s' is truncated", path.c_str());
+		close();
+		return false;
+	}
+
+	header = candidate;
+	frames = (const int8_t*)(file.data() + sizeof(WindFlipbookHeader));
+	time = 0.0f;
+
+	density.resize((size_t)fieldSize);
+	velX.resize((size_t)fieldSize);
+	velY.resize((size_t)fieldSize);
+
+	LOG_INFO("Opened flipbook '%s' with %u frames", path.c_str(), header->frameCount);
+	return true;
+}
+
+void WindFlipbook::close()
+{
+	file.close();
+	header = nullptr;
+	frames = nullptr;
+}
+
+bool WindFlipbook::isOpen() const
+{
+	return header != nullptr;
+}
+
+void WindFlipbook::play(float deltaTime, FluidGrid& fluidGrid)
+{
+	if (!header)
+		return;
+
+	int resolution = (int)header->resolution;
+	if (resolution != fluidGrid.getN() + 2)
+	{
+		LOG_WARNING("Flipbook resolution %d does not match the fluid grid resolution %d. Closing it.",
+			resolution, fluidGrid.getN() + 2);
+		close();
+		return;
+	}
+
+	float duration = header->frameCount / header->framesPerSecond;
+	time = std::fmod(time + deltaTime * playbackSpeed, duration);
+	if (time < 0.0f)
+		time += duration;
+
+	float framePosition = time * header->framesPerSecond;
+	int frameA = (int)framePosition % (int)header->frameCount;
+	int frameB = (frameA + 1) % (int)header->frameCount;
+	float blend = framePosition - std::floor(framePosition);
+
+	size_t fieldSize = (size_t)resolution * resolution;
+	const int8_t* a = frames + frameA * WIND_FLIPBOOK_FIELDS * fieldSize;
+	const int8_t* b = frames + frameB * WIND_FLIPBOOK_FIELDS * fieldSize;
+
+	dequantizeBlended(a, b, blend, header->densityScale, fieldSize, density.data());
+	dequantizeBlended(a + fieldSize, b + fieldSize, blend, header->velXScale, fieldSize, velX.data());
+	dequantizeBlended(a + 2 * fieldSize, b + 2 * fieldSize, blend, header->velYScale, fieldSize, velY.data());
+
+	fluidGrid.uploadFields(density.data(), velX.data(), velY.data());
+}
+
+int WindFlipbook::getResolution() const
+{
+	return header ? (int)header->resolution : 0;
+}
+
+int WindFlipbook::getFrameCount() const
+{
+	return header ? (int)header->frameCount : 0;
+}
+
+float WindFlipbook::getFramesPerSecond() const
+{
+	return header ? header->framesPerSecond : 0.0f;
+}
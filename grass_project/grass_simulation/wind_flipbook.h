@@ -0,0 +1,98 @@
+#ifndef WIND_FLIPBOOK_H
+#define WIND_FLIPBOOK_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "fluid_grid.h"
+#include "mapped_file.h"
+
+/**
+ * \brief Layout of the start of a baked wind flipbook file.
+ * The header is followed by frameCount frames. Each frame holds the
+ * density, velocity x and velocity y fields, in that order, as
+ * resolution x resolution signed bytes. A field value is the byte divided by
+ * 127 and multiplied by the scale of that field.
+ */
+struct WindFlipbookHeader
+{
+	char     magic[4];
+	uint32_t version;
+	uint32_t resolution;
+	uint32_t frameCount;
+	float    framesPerSecond;
+	float    densityScale;
+	float    velXScale;
+	float    velYScale;
+};
+
+/**
+ * \brief Settings for baking a flipbook.
+ * warmupSeconds:		Simulated, but not recorded, so the wind has settled
+ *						when the recording starts.
+ * seconds:				Length of the loop.
+ * crossfadeSeconds:	Extra time that is simulated after the loop and
+ *						faded into the start, hiding the seam of the loop.
+ */
+struct WindFlipbookBakeSettings
+{
+	int   N = 128;
+	float diffusion = 0.00056f;
+	float viscosity = 0.0f;
+	float warmupSeconds = 5.0f;
+	float seconds = 10.0f;
+	float crossfadeSeconds = 2.0f;
+	int   framesPerSecond = 30;
+};
+
+/**
+ * \brief A looping wind sequence, baked from a FluidGrid and played back
+ * from a memory-mapped file instead of simulating.
+ */
+class WindFlipbook
+{
+public:
+	/**
+	 * \brief Simulates a headless FluidGrid driven by fans, makes the
+	 * recording loop and writes it quantized to path.
+	 * \return True if the flipbook was written.
+	 */
+	static bool bake(const std::string& path, const WindFlipbookBakeSettings& settings, const std::vector<Fan>& fans);
+
+	/**
+	 * \brief Maps a baked flipbook for playback.
+	 * \return True if the file is a valid flipbook.
+	 */
+	bool open(const std::string& path);
+	void close();
+	bool isOpen() const;
+
+	/**
+	 * \brief Advances playback and uploads the current frame through the
+	 * upload path of the fluid grid, blending between baked frames.
+	 * The resolution of the flipbook has to match the fluid grid.
+	 */
+	void play(float deltaTime, FluidGrid& fluidGrid);
+
+	int getResolution() const;
+	int getFrameCount() const;
+	float getFramesPerSecond() const;
+
+	float playbackSpeed = 1.0f;
+
+private:
+	MappedFile file;
+	const WindFlipbookHeader* header = nullptr;
+	const int8_t* frames = nullptr;
+	float time = 0.0f;
+
+	/**
+	 * \brief Dequantized fields of the current frame, ready for uploading.
+	 */
+	std::vector<float> density;
+	std::vector<float> velX;
+	std::vector<float> velY;
+};
+
+#endif
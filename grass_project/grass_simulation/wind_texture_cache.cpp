@@ -0,0 +1,98 @@
+#include "wind_texture_cache.h"
+#include "rendering/texture.h"
+
+#include <algorithm>
+
+bool WindTextureKey::operator==(const WindTextureKey& other) const
+{
+	return generator == other.generator && octaves == other.octaves && bias == other.bias &&
+		seed == other.seed && checkerSize == other.checkerSize && size == other.size;
+}
+
+WindTextureCache::WindTextureCache(size_t maxBytes)
+	: maxBytes(maxBytes)
+{
+}
+
+WindTextureCache::~WindTextureCache()
+{
+	clear();
+}
+
+Texture* WindTextureCache::find(const WindTextureKey& key)
+{
+	auto it = std::find_if(entries.begin(), entries.end(), [&](const Entry& entry) { return entry.key == key; });
+	if (it == entries.end())
+	{
+		misses++;
+		return nullptr;
+	}
+
+	hits++;
+	entries.splice(entries.begin(), entries, it);
+	return it->texture;
+}
+
+Texture* WindTextureCache::insert(const WindTextureKey& key, const std::vector<const Texture*>& inUse)
+{
+	// A single channel of 8 bits
+	size_t bytes = (size_t)key.size * (size_t)key.size;
+	evict(bytes, inUse);
+
+	Texture* texture = new Texture("Cached Wind Texture", GL_TEXTURE_2D);
+	texture->loadTextureSingleChannel(key.size);
+
+	entries.push_front({ key, texture, bytes });
+	usedBytes += bytes;
+	return texture;
+}
+
+void WindTextureCache::evict(size_t bytes, const std::vector<const Texture*>& inUse)
+{
+	auto it = entries.end();
+	while (usedBytes + bytes > maxBytes && it != entries.begin())
+	{
+		--it;
+		if (std::find(inUse.begin(), inUse.end(), it->texture) != inUse.end())
+			continue;
+
+		usedBytes -= it->bytes;
+		delete it->texture;
+		it = entries.erase(it);
+	}
+}
+
+void WindTextureCache::clear()
+{
+	for (Entry& entry : entries)
+	{
+		delete entry.texture;
+	}
+	entries.clear();
+	usedBytes = 0;
+}
+
+size_t WindTextureCache::getUsedBytes() const
+{
+	return usedBytes;
+}
+
+size_t WindTextureCache::getMaxBytes() const
+{
+	return maxBytes;
+}
+
+size_t WindTextureCache::getTextureCount() const
+{
+	return entries.size();
+}
+
+int WindTextureCache::getHits() const
+{
+	return hits;
+}
+
+int WindTextureCache::getMisses() const
+{
+	return misses;
+}
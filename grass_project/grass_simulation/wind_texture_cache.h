@@ -0,0 +1,103 @@
+#ifndef WIND_TEXTURE_CACHE_H
+#define WIND_TEXTURE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <vector>
+
+class Texture;
+
+/**
+* Represents what generated a wind texture
+*/
+enum class WindTextureGenerator {
+	VALUE_NOISE,
+	GRADIENT_NOISE,
+	CHECKER_PATTERN
+};
+
+/**
+ * \brief Everything a generated wind texture depends on. Parameters a generator
+ * does not use should be left at their defaults, so they do not split entries.
+ */
+struct WindTextureKey
+{
+	WindTextureGenerator generator = WindTextureGenerator::GRADIENT_NOISE;
+	int      octaves = 0;
+	float    bias = 0.0f;
+	uint32_t seed = 0;
+	int      checkerSize = 0;
+	int      size = 0;
+
+	bool operator==(const WindTextureKey& other) const;
+};
+
+/**
+ * \brief Keeps recently generated single channel wind textures, so going back
+ * to a configuration only swaps the texture that is bound instead of
+ * generating it again. The least recently used textures are deleted once the
+ * textures take more GPU memory than allowed.
+ */
+class WindTextureCache
+{
+public:
+	/**
+	 * \param maxBytes GPU memory the textures may take.
+	 */
+	explicit WindTextureCache(size_t maxBytes);
+	~WindTextureCache();
+
+	WindTextureCache(const WindTextureCache&) = delete;
+	WindTextureCache& operator=(const WindTextureCache&) = delete;
+
+	/**
+	 * \brief The texture generated for key, which becomes the most recently
+	 * used one. nullptr if there is none.
+	 */
+	Texture* find(const WindTextureKey& key);
+
+	/**
+	 * \brief Creates an empty key.size x key.size texture for key, which the
+	 * caller has to generate. Evicts the least recently used textures to make
+	 * room for it.
+	 * \param inUse Textures that are still referenced elsewhere and must not be
+	 * evicted, even if that means going over the memory limit for a while.
+	 */
+	Texture* insert(const WindTextureKey& key, const std::vector<const Texture*>& inUse);
+
+	/**
+	 * \brief Deletes every texture.
+	 */
+	void clear();
+
+	size_t getUsedBytes() const;
+	size_t getMaxBytes() const;
+	size_t getTextureCount() const;
+	int getHits() const;
+	int getMisses() const;
+
+private:
+	struct Entry
+	{
+		WindTextureKey key;
+		Texture* texture;
+		size_t bytes;
+	};
+
+	/**
+	 * \brief Deletes least recently used textures until bytes more fit.
+	 */
+	void evict(size_t bytes, const std::vector<const Texture*>& inUse);
+
+	/**
+	 * \brief Most recently used first.
+	 */
+	std::list<Entry> entries;
+	size_t usedBytes = 0;
+	size_t maxBytes = 0;
+	int hits = 0;
+	int misses = 0;
+};
+
+#endif
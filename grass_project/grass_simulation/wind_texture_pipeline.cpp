@@ -0,0 +1,82 @@
+#include "wind_texture_pipeline.h"
+#include "debug.h"
+
+#include <algorithm>
+
+WindTexturePipeline::~WindTexturePipeline()
+{
+	for (Pending& generation : pending)
+	{
+		GLCall(glDeleteSync(generation.fence));
+	}
+}
+
+void WindTexturePipeline::submit(Texture** target, Texture* texture)
+{
+	cancel(target);
+
+	// Compute shaders write the texture as an image, everything after reads
+	// it through samplers
+	GLCall(glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT));
+
+	if (*target == nullptr)
+	{
+		// Nothing to keep rendering with in the meantime
+		*target = texture;
+		return;
+	}
+
+	GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	pending.push_back({ target, texture, fence });
+}
+
+void WindTexturePipeline::cancel(Texture** target)
+{
+	auto it = std::find_if(pending.begin(), pending.end(), [&](const Pending& generation) { return generation.target == target; });
+	if (it != pending.end())
+	{
+		GLCall(glDeleteSync(it->fence));
+		pending.erase(it);
+	}
+}
+
+bool WindTexturePipeline::poll()
+{
+	bool changed = false;
+	for (auto it = pending.begin(); it != pending.end();)
+	{
+		// A timeout of zero only checks the fence. Flushing makes sure it
+		// reaches the GPU and signals at all.
+		GLenum result = glClientWaitSync(it->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED)
+		{
+			if (result == GL_WAIT_FAILED)
+			{
+				LOG_ERROR("Waiting for wind texture generation failed, using the texture anyway");
+			}
+
+			*it->target = it->texture;
+			changed = true;
+			GLCall(glDeleteSync(it->fence));
+			it = pending.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+	return changed;
+}
+
+bool WindTexturePipeline::isPending(const Texture* texture) const
+{
+	return std::any_of(pending.begin(), pending.end(), [&](const Pending& generation) { return generation.texture == texture; });
+}
+
+void WindTexturePipeline::getPendingTextures(std::vector<const Texture*>& textures) const
+{
+	for (const Pending& generation : pending)
+	{
+		textures.push_back(generation.texture);
+	}
+}
@@ -0,0 +1,65 @@
+#ifndef WIND_TEXTURE_PIPELINE_H
+#define WIND_TEXTURE_PIPELINE_H
+
+#include <vector>
+
+#include <glad/glad.h>
+
+class Texture;
+
+/**
+ * \brief Swaps generated wind textures in only once the GPU has finished them.
+ * Generation renders into a back texture and submits it here, which fences
+ * the work. The target keeps pointing at the old texture, so rendering goes on
+ * with it, until a poll finds the fence signalled. No frame ever waits for
+ * generation.
+ */
+class WindTexturePipeline
+{
+public:
+	WindTexturePipeline() = default;
+	~WindTexturePipeline();
+
+	WindTexturePipeline(const WindTexturePipeline&) = delete;
+	WindTexturePipeline& operator=(const WindTexturePipeline&) = delete;
+
+	/**
+	 * \brief Fences the commands that generate texture, which have to be
+	 * issued right before. target is pointed at texture once they finished,
+	 * or right away if it points at nothing yet. Replaces any texture still
+	 * pending for target.
+	 */
+	void submit(Texture** target, Texture* texture);
+
+	/**
+	 * \brief Forgets the texture pending for target, which keeps pointing at
+	 * whatever it points at now.
+	 */
+	void cancel(Texture** target);
+
+	/**
+	 * \brief Points the targets at the textures that finished. Never waits.
+	 * \return True if any target changed.
+	 */
+	bool poll();
+
+	bool isPending(const Texture* texture) const;
+
+	/**
+	 * \brief Textures that are still being generated. They will be pointed to
+	 * later, so they have to stay alive.
+	 */
+	void getPendingTextures(std::vector<const Texture*>& textures) const;
+
+private:
+	struct Pending
+	{
+		Texture** target;
+		Texture* texture;
+		GLsync fence;
+	};
+
+	std::vector<Pending> pending;
+};
+
+#endif
@@ -40,6 +40,7 @@ Velocity: 2.7
 #include "rendering/shader.h"
 #include "rendering/shader_program.h"
 #include "rendering/glmutils.h"
+#include "rendering/gl_state.h"
 
 #include "camera.h"
 #include "debug.h"
@@ -150,6 +151,11 @@ float lastFrame = 0.0f;
 */
 long numFrames = 0;
 
+/**
+ * \brief Shows the GL state calls of the last frame
+*/
+bool showGlStateCounters = false;
+
 /**
  * \brief The window being rendered to
 */
@@ -172,6 +178,12 @@ void initIMGUI(GLFWwindow* window);
 */
 void drawGui();
 
+/**
+ * \brief Draws how many GL state calls GLState issued and skipped in the
+ * last frame
+*/
+void drawGlStateCounters();
+
 /**
  * @brief The GLFW callback for screen resize. Resizes the viewport.
  * @param window The resized window.
@@ -267,6 +279,7 @@ int main()
 		drawGui();
 
 		glfwSwapBuffers(window);
+		GLState::endFrame();
 
 		// Render loop : render every loopInterval seconds
 		float loopInterval = 0.02f;
@@ -354,6 +367,8 @@ void initCommonShadersAndTextures()
 	lightShaderProgram = new ShaderProgram({ lightVertexShader, lightFragmentShader }, "LIGHT SHADER");
 	scene.lightShaderProgram = lightShaderProgram;
 
+	scene.uniformBuffer = new SceneUniformBuffer();
+
 	scene.cubemapTextureDay = cubemapTextureDay;
 	scene.cubemapTextureNight = cubemapTextureNight;
 	scene.currentSkyboxTexture = scene.cubemapTextureNight;
@@ -361,9 +376,9 @@ void initCommonShadersAndTextures()
 	// Set up the z-buffer
 	glDepthRange(-1, 1); // Make the NDC a right handed coordinate system, 
 	// with the camera pointing towards -z
-	glEnable(GL_DEPTH_TEST); // Turn on z-buffer depth perlinNoiseTexture
+	GLState::enable(GL_DEPTH_TEST); // Turn on z-buffer depth perlinNoiseTexture
 	glDepthFunc(GL_LESS);    // Draws fragments that are closer to the screen in NDC
-	glEnable(GL_MULTISAMPLE);
+	GLState::enable(GL_MULTISAMPLE);
 }
 
 GLFWwindow* initGLFWWindow()
@@ -473,6 +488,8 @@ void drawSettingsWindow()
 		}
 	}
 
+	ImGui::Checkbox("Show GL State Counters", &showGlStateCounters);
+
 	if (ImGui::CollapsingHeader("Controls"))
 	{
 		ImGui::Text("WASD for camera movement");
@@ -504,6 +521,10 @@ void drawGui()
 		GrassSimulation::drawGui();
 	}
 	drawSettingsWindow();
+	if (showGlStateCounters)
+	{
+		drawGlStateCounters();
+	}
 
 	ImGui::Render();
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
@@ -524,6 +545,43 @@ void drawGui()
 	}
 }
 
+void drawGlStateCounters()
+{
+	ImGui::Begin("GL State", &showGlStateCounters, ImGuiWindowFlags_AlwaysAutoResize);
+
+	int totalIssued = 0;
+	int totalSkipped = 0;
+	ImGui::Columns(3);
+	ImGui::Text("Call");
+	ImGui::NextColumn();
+	ImGui::Text("Issued");
+	ImGui::NextColumn();
+	ImGui::Text("Skipped");
+	ImGui::NextColumn();
+	ImGui::Separator();
+	for (int i = 0; i < (int)GLStateCall::COUNT; i++)
+	{
+		GLStateCall kind = (GLStateCall)i;
+		totalIssued += GLState::getIssuedCalls(kind);
+		totalSkipped += GLState::getSkippedCalls(kind);
+		ImGui::Text("%s", GLState::getCallName(kind));
+		ImGui::NextColumn();
+		ImGui::Text("%d", GLState::getIssuedCalls(kind));
+		ImGui::NextColumn();
+		ImGui::Text("%d", GLState::getSkippedCalls(kind));
+		ImGui::NextColumn();
+	}
+	ImGui::Separator();
+	ImGui::Text("Total");
+	ImGui::NextColumn();
+	ImGui::Text("%d", totalIssued);
+	ImGui::NextColumn();
+	ImGui::Text("%d", totalSkipped);
+	ImGui::Columns(1);
+
+	ImGui::End();
+}
+
 void framebufferSizeCallback(GLFWwindow* window, int width, int height)
 {
 	// Makes sure the viewport matches the new window dimensions; note that width and
@@ -634,6 +692,7 @@ void cleanUp()
 	delete lightVertexShader;
 	delete lightFragmentShader;
 	delete lightShaderProgram;
+	delete scene.uniformBuffer;
 
 	GrassSimulation::cleanup();
 }
@@ -0,0 +1,150 @@
+#include "mapped_file.h"
+#include "logger.h"
+
+#ifdef _WIN32
+#define NOGDI
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path, bool copyOnWrite)
+{
+	close();
+
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		LOG_ERROR("Could not open '%s' for mapping", path.c_str());
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		LOG_ERROR("Could not map '%s', the file is empty", path.c_str());
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE fileMapping = CreateFileMappingA(file, nullptr, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+	if (!fileMapping)
+	{
+		LOG_ERROR("Could not create a file mapping for '%s'", path.c_str());
+		CloseHandle(file);
+		return false;
+	}
+
+	void* view = MapViewOfFile(fileMapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+	if (!view)
+	{
+		LOG_ERROR("Could not map a view of '%s'", path.c_str());
+		CloseHandle(fileMapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	fileHandle = file;
+	mappingHandle = fileMapping;
+	mapping = (unsigned char*)view;
+	mappingSize = (size_t)fileSize.QuadPart;
+	isCopyOnWrite = copyOnWrite;
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (mapping)
+	{
+		UnmapViewOfFile(mapping);
+		CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+	}
+	mapping = nullptr;
+	mappingSize = 0;
+	isCopyOnWrite = false;
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path, bool copyOnWrite)
+{
+	close();
+
+	int file = ::open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		LOG_ERROR("Could not open '%s' for mapping", path.c_str());
+		return false;
+	}
+
+	struct stat fileStat;
+	if (fstat(file, &fileStat) != 0 || fileStat.st_size == 0)
+	{
+		LOG_ERROR("Could not map '%s', the file is empty", path.c_str());
+		::close(file);
+		return false;
+	}
+
+	int protection = copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ;
+	void* view = mmap(nullptr, (size_t)fileStat.st_size, protection, MAP_PRIVATE, file, 0);
+	// The mapping keeps its own reference to the file
+	::close(file);
+	if (view == MAP_FAILED)
+	{
+		LOG_ERROR("Could not map '%s'", path.c_str());
+		return false;
+	}
+
+	mapping = (unsigned char*)view;
+	mappingSize = (size_t)fileStat.st_size;
+	isCopyOnWrite = copyOnWrite;
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (mapping)
+	{
+		munmap(mapping, mappingSize);
+	}
+	mapping = nullptr;
+	mappingSize = 0;
+	isCopyOnWrite = false;
+}
+
+#endif
+
+bool MappedFile::isOpen() const
+{
+	return mapping != nullptr;
+}
+
+const unsigned char* MappedFile::data() const
+{
+	return mapping;
+}
+
+unsigned char* MappedFile::writableData()
+{
+	return isCopyOnWrite ? mapping : nullptr;
+}
+
+size_t MappedFile::size() const
+{
+	return mappingSize;
+}
@@ -0,0 +1,69 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+
+/**
+ * \brief RAII wrapper for a memory-mapped file.
+ * Constructor does nothing, open() maps the file, destructor unmaps it.
+ * The mapped data is only valid while the MappedFile is open.
+ */
+class MappedFile
+{
+public:
+	MappedFile() = default;
+
+	/**
+	 * \brief Unmaps the file, if one is open.
+	 */
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/**
+	 * \brief Maps the whole file into memory, closing any file that was
+	 * mapped before.
+	 * \param path Path to the file you want to map.
+	 * \param copyOnWrite Maps the file writable, but private. Writes go to
+	 * copies of the touched pages and never reach the file.
+	 * \return True if the file could be mapped.
+	 */
+	bool open(const std::string& path, bool copyOnWrite = false);
+
+	/**
+	 * \brief Unmaps the file.
+	 */
+	void close();
+
+	bool isOpen() const;
+
+	/**
+	 * \brief Start of the mapped file, nullptr if no file is mapped.
+	 */
+	const unsigned char* data() const;
+
+	/**
+	 * \brief Writable start of the mapped file, nullptr if no file is mapped
+	 * or the file was not mapped copy-on-write.
+	 */
+	unsigned char* writableData();
+
+	/**
+	 * \brief Size of the mapped file in bytes.
+	 */
+	size_t size() const;
+
+private:
+	unsigned char* mapping = nullptr;
+	size_t mappingSize = 0;
+	bool isCopyOnWrite = false;
+
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif
+};
+
+#endif
@@ -0,0 +1,218 @@
+#include "gl_state.h"
+#include "debug.h"
+
+#include <cstdint>
+#include <unordered_map>
+
+namespace {
+	const int CALL_KINDS = (int)GLStateCall::COUNT;
+
+	/**
+	 * \brief Binding that was not set through GLState
+	 */
+	const GLuint UNKNOWN = 0xffffffffu;
+
+	GLuint program = UNKNOWN;
+	GLuint vertexArray = UNKNOWN;
+	GLuint activeUnit = UNKNOWN;
+
+	/**
+	 * \brief Buffer bound to every target
+	 */
+	std::unordered_map<GLenum, GLuint> buffers;
+
+	/**
+	 * \brief Buffer bound to every index of a target, keyed by both
+	 */
+	std::unordered_map<uint64_t, GLuint> indexedBuffers;
+
+	/**
+	 * \brief Texture bound to every target of a unit, keyed by both
+	 */
+	std::unordered_map<uint64_t, GLuint> textures;
+
+	std::unordered_map<GLenum, bool> capabilities;
+
+	int issued[CALL_KINDS] = {};
+	int skipped[CALL_KINDS] = {};
+	int lastIssued[CALL_KINDS] = {};
+	int lastSkipped[CALL_KINDS] = {};
+
+	uint64_t makeKey(GLuint high, GLuint low) {
+		return ((uint64_t)high << 32) | low;
+	}
+
+	/**
+	 * \brief Counts the call, and whether it has to be made
+	 */
+	bool changes(GLStateCall kind, GLuint& current, GLuint value) {
+		if (current == value) {
+			skipped[(int)kind]++;
+			return false;
+		}
+		issued[(int)kind]++;
+		current = value;
+		return true;
+	}
+
+	/**
+	 * \brief Forgets the bindings of an object that was deleted, OpenGL
+	 * binds 0 in its place
+	 */
+	template <typename Key>
+	void unbind(std::unordered_map<Key, GLuint>& bindings, GLuint object) {
+		for (auto& binding : bindings) {
+			if (binding.second == object)
+				binding.second = 0;
+		}
+	}
+}
+
+namespace GLState {
+	void useProgram(GLuint id) {
+		if (changes(GLStateCall::PROGRAM, program, id)) {
+			GLCall(glUseProgram(id));
+		}
+	}
+
+	void bindVertexArray(GLuint id) {
+		if (changes(GLStateCall::VERTEX_ARRAY, vertexArray, id)) {
+			GLCall(glBindVertexArray(id));
+		}
+	}
+
+	void bindBuffer(GLenum target, GLuint buffer) {
+		if (target == GL_ELEMENT_ARRAY_BUFFER) {
+			issued[(int)GLStateCall::BUFFER]++;
+			GLCall(glBindBuffer(target, buffer));
+			return;
+		}
+		auto it = buffers.emplace(target, UNKNOWN).first;
+		if (changes(GLStateCall::BUFFER, it->second, buffer)) {
+			GLCall(glBindBuffer(target, buffer));
+		}
+	}
+
+	void bindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+		// Binds the generic target too
+		auto it = indexedBuffers.emplace(makeKey(target, index), UNKNOWN).first;
+		if (changes(GLStateCall::BUFFER, it->second, buffer)) {
+			GLCall(glBindBufferBase(target, index, buffer));
+			buffers[target] = buffer;
+		}
+	}
+
+	void bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+		// Ranges are not remembered, a base bind of the same buffer has to
+		// be made again
+		issued[(int)GLStateCall::BUFFER]++;
+		GLCall(glBindBufferRange(target, index, buffer, offset, size));
+		indexedBuffers[makeKey(target, index)] = UNKNOWN;
+		buffers[target] = buffer;
+	}
+
+	void activeTexture(GLuint unit) {
+		if (changes(GLStateCall::ACTIVE_TEXTURE, activeUnit, unit)) {
+			GLCall(glActiveTexture(GL_TEXTURE0 + unit));
+		}
+	}
+
+	void bindTexture(GLenum target, GLuint texture) {
+		if (activeUnit == UNKNOWN) {
+			issued[(int)GLStateCall::TEXTURE]++;
+			GLCall(glBindTexture(target, texture));
+			return;
+		}
+		auto it = textures.emplace(makeKey(activeUnit, target), UNKNOWN).first;
+		if (changes(GLStateCall::TEXTURE, it->second, texture)) {
+			GLCall(glBindTexture(target, texture));
+		}
+	}
+
+	void enable(GLenum capability) {
+		setEnabled(capability, true);
+	}
+
+	void disable(GLenum capability) {
+		setEnabled(capability, false);
+	}
+
+	void setEnabled(GLenum capability, bool enabled) {
+		auto it = capabilities.find(capability);
+		if (it != capabilities.end() && it->second == enabled) {
+			skipped[(int)GLStateCall::CAPABILITY]++;
+			return;
+		}
+		issued[(int)GLStateCall::CAPABILITY]++;
+		capabilities[capability] = enabled;
+		if (enabled) {
+			GLCall(glEnable(capability));
+		}
+		else {
+			GLCall(glDisable(capability));
+		}
+	}
+
+	void deleteBuffer(GLuint buffer) {
+		GLCall(glDeleteBuffers(1, &buffer));
+		unbind(buffers, buffer);
+		unbind(indexedBuffers, buffer);
+	}
+
+	void deleteTexture(GLuint texture) {
+		GLCall(glDeleteTextures(1, &texture));
+		unbind(textures, texture);
+	}
+
+	void deleteVertexArray(GLuint id) {
+		GLCall(glDeleteVertexArrays(1, &id));
+		if (vertexArray == id)
+			vertexArray = 0;
+	}
+
+	void invalidate() {
+		program = UNKNOWN;
+		vertexArray = UNKNOWN;
+		activeUnit = UNKNOWN;
+		buffers.clear();
+		indexedBuffers.clear();
+		textures.clear();
+		capabilities.clear();
+	}
+
+	void endFrame() {
+		for (int i = 0; i < CALL_KINDS; i++) {
+			lastIssued[i] = issued[i];
+			lastSkipped[i] = skipped[i];
+			issued[i] = 0;
+			skipped[i] = 0;
+		}
+	}
+
+	int getIssuedCalls(GLStateCall kind) {
+		return lastIssued[(int)kind];
+	}
+
+	int getSkippedCalls(GLStateCall kind) {
+		return lastSkipped[(int)kind];
+	}
+
+	const char* getCallName(GLStateCall kind) {
+		switch (kind) {
+		case GLStateCall::PROGRAM:
+			return "Program";
+		case GLStateCall::VERTEX_ARRAY:
+			return "Vertex array";
+		case GLStateCall::BUFFER:
+			return "Buffer";
+		case GLStateCall::ACTIVE_TEXTURE:
+			return "Active texture";
+		case GLStateCall::TEXTURE:
+			return "Texture";
+		case GLStateCall::CAPABILITY:
+			return "Enable";
+		default:
+			return "";
+		}
+	}
+}
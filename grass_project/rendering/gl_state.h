@@ -0,0 +1,87 @@
+/*
+ * GLState remembers the OpenGL state it set and skips calls that would not
+ * change it.
+ */
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+/**
+ * \brief Kinds of state calls GLState counts
+ */
+enum class GLStateCall {
+	PROGRAM,
+	VERTEX_ARRAY,
+	BUFFER,
+	ACTIVE_TEXTURE,
+	TEXTURE,
+	CAPABILITY,
+	COUNT
+};
+
+/**
+ * \brief Filters redundant binds and enables. Only works if all calls of a
+ * kind go through it, ImGui restores what it changes so it may go around.
+ * State nothing set through GLState yet is unknown, the first call always
+ * goes to OpenGL. Element array buffers belong to the vertex array and are
+ * never skipped.
+ */
+namespace GLState {
+	void useProgram(GLuint program);
+	void bindVertexArray(GLuint vertexArray);
+	void bindBuffer(GLenum target, GLuint buffer);
+
+	/**
+	 * \brief Skipped if buffer is bound to index already, the generic target
+	 * then keeps what it had. Bind the generic target itself to use it.
+	 */
+	void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+	void bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+	/**
+	 * \param unit Index of the unit, without GL_TEXTURE0.
+	 */
+	void activeTexture(GLuint unit);
+
+	/**
+	 * \brief Binds texture to the active unit
+	 */
+	void bindTexture(GLenum target, GLuint texture);
+
+	void enable(GLenum capability);
+	void disable(GLenum capability);
+	void setEnabled(GLenum capability, bool enabled);
+
+	/**
+	 * \brief Deletes the objects and forgets where they were bound, OpenGL
+	 * unbinds them and may hand out their names again.
+	 */
+	void deleteBuffer(GLuint buffer);
+	void deleteTexture(GLuint texture);
+	void deleteVertexArray(GLuint vertexArray);
+
+	/**
+	 * \brief Forgets all state, after OpenGL calls that went around GLState
+	 */
+	void invalidate();
+
+	/**
+	 * \brief Starts counting the calls of the next frame
+	 */
+	void endFrame();
+
+	/**
+	 * \brief Calls of kind that went to OpenGL in the last frame
+	 */
+	int getIssuedCalls(GLStateCall kind);
+
+	/**
+	 * \brief Calls of kind that were skipped in the last frame
+	 */
+	int getSkippedCalls(GLStateCall kind);
+
+	const char* getCallName(GLStateCall kind);
+}
+
+#endif
@@ -0,0 +1,45 @@
+#include "gpu_timer.h"
+#include "debug.h"
+
+GpuTimer::GpuTimer() {
+	GLCall(glGenQueries(QUERY_COUNT, queries));
+}
+
+GpuTimer::~GpuTimer() {
+	GLCall(glDeleteQueries(QUERY_COUNT, queries));
+}
+
+void GpuTimer::begin() {
+	collect();
+	GLCall(glBeginQuery(GL_TIME_ELAPSED, queries[next]));
+}
+
+void GpuTimer::end() {
+	GLCall(glEndQuery(GL_TIME_ELAPSED));
+	pending[next] = true;
+	next = (next + 1) % QUERY_COUNT;
+}
+
+float GpuTimer::getMilliseconds() {
+	collect();
+	return milliseconds;
+}
+
+void GpuTimer::collect() {
+	// Oldest first, so the newest finished one wins
+	for (int i = 0; i < QUERY_COUNT; i++) {
+		int query = (next + i) % QUERY_COUNT;
+		if (!pending[query])
+			continue;
+
+		GLint available = 0;
+		GLCall(glGetQueryObjectiv(queries[query], GL_QUERY_RESULT_AVAILABLE, &available));
+		if (!available)
+			continue;
+
+		GLuint64 nanoseconds = 0;
+		GLCall(glGetQueryObjectui64v(queries[query], GL_QUERY_RESULT, &nanoseconds));
+		milliseconds = (float)(nanoseconds / 1.0e6);
+		pending[query] = false;
+	}
+}
@@ -0,0 +1,46 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad.h>
+
+/**
+ * \brief Measures how long the GPU takes for the commands between begin() and
+ * end(), with timer queries. Results are picked up once the GPU has them, so
+ * measuring never stalls the CPU. Timers can not be nested.
+ */
+class GpuTimer {
+public:
+	GpuTimer();
+	~GpuTimer();
+
+	GpuTimer(const GpuTimer&) = delete;
+	GpuTimer& operator=(const GpuTimer&) = delete;
+
+	void begin();
+	void end();
+
+	/**
+	 * \brief The newest measurement that has finished, in milliseconds.
+	 * Zero until the first measurement finishes.
+	 */
+	float getMilliseconds();
+
+private:
+	/**
+	 * \brief Measurements that can be in flight at once. Older ones are
+	 * dropped when more are started.
+	 */
+	static const int QUERY_COUNT = 4;
+
+	/**
+	 * \brief Picks up the results of finished queries.
+	 */
+	void collect();
+
+	GLuint queries[QUERY_COUNT] = {};
+	bool pending[QUERY_COUNT] = {};
+	int next = 0;
+	float milliseconds = 0.0f;
+};
+
+#endif
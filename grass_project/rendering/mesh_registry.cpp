@@ -0,0 +1,114 @@
+#include "mesh_registry.h"
+#include "vertex_layout.h"
+#include "debug.h"
+#include "logger.h"
+#include "gl_state.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+	/**
+	 * \brief FNV-1a over bytes, continuing from hash
+	 */
+	uint64_t hashBytes(const void* data, size_t bytes, uint64_t hash = 14695981039346656037ull) {
+		const unsigned char* byte = (const unsigned char*)data;
+		for (size_t i = 0; i < bytes; i++) {
+			hash = (hash ^ byte[i]) * 1099511628211ull;
+		}
+		return hash;
+	}
+}
+
+const Mesh* MeshRegistry::acquire(const void* vertices, size_t vertexBytes, const std::vector<unsigned int>& indices) {
+	uint64_t hash = hashBytes(vertices, vertexBytes);
+	hash = hashBytes(indices.data(), indices.size() * sizeof(unsigned int), hash);
+
+	auto it = std::find_if(entries.begin(), entries.end(), [&](const Entry& entry) {
+		return entry.hash == hash && entry.vertices.size() == vertexBytes && entry.indices == indices &&
+			std::memcmp(entry.vertices.data(), vertices, vertexBytes) == 0;
+	});
+	if (it != entries.end()) {
+		it->references++;
+		return &it->mesh;
+	}
+
+	Entry entry;
+	entry.hash = hash;
+	entry.vertices.assign((const unsigned char*)vertices, (const unsigned char*)vertices + vertexBytes);
+	entry.indices = indices;
+	entry.references = 1;
+
+	// Uploading must not change the element buffer of a bound vertex array
+	GLint previousVertexArray = 0;
+	GLCall(glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVertexArray));
+	GLState::bindVertexArray(0);
+
+	Mesh& mesh = entry.mesh;
+	GLCall(glGenBuffers(1, &mesh.vertexBuffer));
+	GLState::bindBuffer(GL_ARRAY_BUFFER, mesh.vertexBuffer);
+	GLCall(glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertices, GL_STATIC_DRAW));
+	mesh.bytes = vertexBytes;
+	if (!indices.empty()) {
+		GLCall(glGenBuffers(1, &mesh.indexBuffer));
+		GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBuffer);
+		mesh.indexType = uploadIndices(indices);
+		mesh.indexCount = (unsigned int)indices.size();
+		mesh.bytes += indices.size() * (mesh.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int));
+		GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+	GLState::bindVertexArray(previousVertexArray);
+
+	uploadedBytes += mesh.bytes;
+	entries.push_front(std::move(entry));
+	return &entries.front().mesh;
+}
+
+void MeshRegistry::release(const Mesh* mesh) {
+	if (mesh == nullptr)
+		return;
+
+	auto it = std::find_if(entries.begin(), entries.end(), [&](const Entry& entry) { return &entry.mesh == mesh; });
+	if (it == entries.end()) {
+		LOG_ERROR("Released a mesh that is not in the registry");
+		return;
+	}
+	if (--it->references > 0)
+		return;
+
+	GLState::deleteBuffer(it->mesh.vertexBuffer);
+	if (it->mesh.indexBuffer != 0) {
+		GLState::deleteBuffer(it->mesh.indexBuffer);
+	}
+	uploadedBytes -= it->mesh.bytes;
+	entries.erase(it);
+}
+
+size_t MeshRegistry::getMeshCount() const {
+	return entries.size();
+}
+
+int MeshRegistry::getReferenceCount() const {
+	int references = 0;
+	for (const Entry& entry : entries) {
+		references += entry.references;
+	}
+	return references;
+}
+
+size_t MeshRegistry::getUploadedBytes() const {
+	return uploadedBytes;
+}
+
+size_t MeshRegistry::getSharedBytes() const {
+	size_t bytes = 0;
+	for (const Entry& entry : entries) {
+		bytes += (size_t)(entry.references - 1) * entry.mesh.bytes;
+	}
+	return bytes;
+}
+
+MeshRegistry& MeshRegistry::instance() {
+	static MeshRegistry registry;
+	return registry;
+}
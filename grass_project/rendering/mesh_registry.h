@@ -0,0 +1,85 @@
+/*
+ * The MeshRegistry uploads every distinct mesh once and shares its buffers
+ * between the SceneObjects that draw it.
+ */
+#ifndef MESH_REGISTRY_H
+#define MESH_REGISTRY_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <vector>
+
+/**
+ * \brief GPU buffers of a mesh, owned by the MeshRegistry. Vertex array
+ * objects stay with their SceneObjects, the attribute locations depend on
+ * the shader.
+ */
+struct Mesh {
+	GLuint vertexBuffer = 0;
+	/**
+	 * \brief 0 for meshes drawn without indices
+	 */
+	GLuint indexBuffer = 0;
+	GLenum indexType = GL_UNSIGNED_INT;
+	unsigned int indexCount = 0;
+	size_t bytes = 0;
+};
+
+/**
+ * \brief Hands out shared Meshes. Meshes are told apart by their contents,
+ * so identical vertices and indices share buffers wherever they come from.
+ * A mesh is deleted once everything that acquired it released it, meshes
+ * still held at exit go with the context.
+ */
+class MeshRegistry {
+public:
+	MeshRegistry(const MeshRegistry&) = delete;
+	MeshRegistry& operator=(const MeshRegistry&) = delete;
+
+	/**
+	 * \brief The mesh with these vertices and indices, uploaded if no one
+	 * holds it yet. Has to be released.
+	 * \param indices Empty for meshes drawn without indices.
+	 */
+	const Mesh* acquire(const void* vertices, size_t vertexBytes, const std::vector<unsigned int>& indices);
+
+	void release(const Mesh* mesh);
+
+	/**
+	 * \brief Distinct meshes on the GPU
+	 */
+	size_t getMeshCount() const;
+
+	/**
+	 * \brief Meshes acquired and not released yet, counting shared ones once
+	 * per holder
+	 */
+	int getReferenceCount() const;
+
+	size_t getUploadedBytes() const;
+
+	/**
+	 * \brief Bytes the holders of shared meshes did not upload again
+	 */
+	size_t getSharedBytes() const;
+
+	static MeshRegistry& instance();
+
+private:
+	MeshRegistry() = default;
+
+	struct Entry {
+		Mesh mesh;
+		uint64_t hash;
+		std::vector<unsigned char> vertices;
+		std::vector<unsigned int> indices;
+		int references;
+	};
+
+	std::list<Entry> entries;
+	size_t uploadedBytes = 0;
+};
+
+#endif
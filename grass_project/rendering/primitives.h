@@ -46,6 +46,15 @@ static std::vector<float> grassNormals{ 0.0f, 0.0f, 1.0f,
 										0.0f, 0.0f, 1.0f,
 										0.0f, 0.0f, 1.0f };
 
+/*
+ * A blade as a single control point at its root, expanded into a curved blade
+ * by blades.tesc and blades.tese
+ */
+static std::vector<float> bladeControlPointPositions{ 0.0f, 0.0f, 0.0f };
+static std::vector<float> bladeControlPointColors{ .56f, .60f, .17f, 1.f };
+static std::vector<float> bladeControlPointNormals{ 0.0f, 0.0f, 1.0f };
+static std::vector<unsigned int> bladeControlPointIndices{ 0 };
+
 static std::vector<float> grassPatchPositions{
 	0.0f, 0.0f, 1.0f, // Bot left
 	1.0f, 0.0f, 1.0f, // Bot right
@@ -70,6 +79,51 @@ static std::vector<float> grassPatchNormals{ 0.0f, 1.0f, 0.0f,
 								   0.0f, 1.0f, 0.0f,
 								   0.0f, 1.0f, 0.0f };
 
+/*
+ * Impostor cards of a unit patch: three cards across z and three across x,
+ * as tall as the blade mesh. Each card shows a different third of the baked
+ * blades, the texture wraps around.
+ */
+static std::vector<float> impostorCardPositions{
+	0.0f, 0.0f, 0.1667f,	1.0f, 0.0f, 0.1667f,	1.0f, 0.5f, 0.1667f,	0.0f, 0.5f, 0.1667f,
+	0.0f, 0.0f, 0.5f,		1.0f, 0.0f, 0.5f,		1.0f, 0.5f, 0.5f,		0.0f, 0.5f, 0.5f,
+	0.0f, 0.0f, 0.8333f,	1.0f, 0.0f, 0.8333f,	1.0f, 0.5f, 0.8333f,	0.0f, 0.5f, 0.8333f,
+	0.1667f, 0.0f, 1.0f,	0.1667f, 0.0f, 0.0f,	0.1667f, 0.5f, 0.0f,	0.1667f, 0.5f, 1.0f,
+	0.5f, 0.0f, 1.0f,		0.5f, 0.0f, 0.0f,		0.5f, 0.5f, 0.0f,		0.5f, 0.5f, 1.0f,
+	0.8333f, 0.0f, 1.0f,	0.8333f, 0.0f, 0.0f,	0.8333f, 0.5f, 0.0f,	0.8333f, 0.5f, 1.0f,
+};
+
+static std::vector<float> impostorCardUVs{
+	0.0f, 0.0f,		1.0f, 0.0f,		1.0f, 1.0f,		0.0f, 1.0f,
+	0.3333f, 0.0f,	1.3333f, 0.0f,	1.3333f, 1.0f,	0.3333f, 1.0f,
+	0.6667f, 0.0f,	1.6667f, 0.0f,	1.6667f, 1.0f,	0.6667f, 1.0f,
+	0.1667f, 0.0f,	1.1667f, 0.0f,	1.1667f, 1.0f,	0.1667f, 1.0f,
+	0.5f, 0.0f,		1.5f, 0.0f,		1.5f, 1.0f,		0.5f, 1.0f,
+	0.8333f, 0.0f,	1.8333f, 0.0f,	1.8333f, 1.0f,	0.8333f, 1.0f,
+};
+
+static std::vector<unsigned int> impostorCardIndices{
+	0, 1, 2,	2, 3, 0,
+	4, 5, 6,	6, 7, 4,
+	8, 9, 10,	10, 11, 8,
+	12, 13, 14,	14, 15, 12,
+	16, 17, 18,	18, 19, 16,
+	20, 21, 22,	22, 23, 20,
+};
+
+// The baked blades carry the color
+static std::vector<float> impostorCardColors(24 * 4, 1.0f);
+
+// The normal of the plane of each card, the way its corners wind
+static std::vector<float> impostorCardNormals{
+	0.0f, 0.0f, 1.0f,	0.0f, 0.0f, 1.0f,	0.0f, 0.0f, 1.0f,	0.0f, 0.0f, 1.0f,
+	0.0f, 0.0f, 1.0f,	0.0f, 0.0f, 1.0f,	0.0f, 0.0f, 1.0f,	0.0f, 0.0f, 1.0f,
+	0.0f, 0.0f, 1.0f,	0.0f, 0.0f, 1.0f,	0.0f, 0.0f, 1.0f,	0.0f, 0.0f, 1.0f,
+	1.0f, 0.0f, 0.0f,	1.0f, 0.0f, 0.0f,	1.0f, 0.0f, 0.0f,	1.0f, 0.0f, 0.0f,
+	1.0f, 0.0f, 0.0f,	1.0f, 0.0f, 0.0f,	1.0f, 0.0f, 0.0f,	1.0f, 0.0f, 0.0f,
+	1.0f, 0.0f, 0.0f,	1.0f, 0.0f, 0.0f,	1.0f, 0.0f, 0.0f,	1.0f, 0.0f, 0.0f,
+};
+
 static std::vector<float> cubePositions{
 	-0.5f, 0.5f, -0.5f,
 	-0.5f, -0.5f, -0.5f,
@@ -189,5 +243,29 @@ static std::vector<float> fanDebugIconVertexPositions{
 	0.0f, 0.05f, 1.0f,
 };
 
+// Camera facing quad for the wind particles, in view space
+static std::vector<float> particleQuadPositions{ -0.5f, -0.5f, 0.0f,
+												  0.5f, -0.5f, 0.0f,
+												  0.5f,  0.5f, 0.0f,
+												 -0.5f,  0.5f, 0.0f };
+
+static std::vector<float> particleQuadUVs{ 0.0f, 0.0f,
+										   1.0f, 0.0f,
+										   1.0f, 1.0f,
+										   0.0f, 1.0f };
+
+static std::vector<unsigned int> particleQuadIndices{ 0, 1, 2,
+													  2, 3, 0 };
+
+static std::vector<float> particleQuadColors{ 1.0f, 1.0f, 1.0f, 1.f,
+											  0.9f, 0.9f, 0.9f, 1.f,
+											  1.0f, 1.0f, 1.0f, 1.f,
+											  0.9f, 0.9f, 0.9f, 1.f };
+
+static std::vector<float> particleQuadNormals{ 0.0f, 0.0f, 1.0f,
+											   0.0f, 0.0f, 1.0f,
+											   0.0f, 0.0f, 1.0f,
+											   0.0f, 0.0f, 1.0f };
+
 
 #endif // PRIMITIVES_H
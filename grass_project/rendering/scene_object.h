@@ -14,6 +14,8 @@
 #include "texture.h"
 #include "glmutils.h"
 #include "shader_program.h"
+#include "vertex_layout.h"
+#include "mesh_registry.h"
 
 class Scene;
 
@@ -24,6 +26,14 @@ class Scene;
 class SceneObject {
 public:
 	SceneObject(ShaderProgram& shaderProgram);
+	/**
+	* \brief Releases the mesh, see MeshRegistry
+	*/
+	virtual ~SceneObject();
+
+	SceneObject(const SceneObject&) = delete;
+	SceneObject& operator=(const SceneObject&) = delete;
+
 	virtual void draw(Scene& scene) = 0;
 	/**
 	* \brief Sets all active uniforms, based on the user's settings
@@ -33,20 +43,30 @@ public:
 	bool isVisible = true;
 
 protected:
+	/**
+	* \brief Binds the shared buffer with the vertex data to GL_ARRAY_BUFFER,
+	* for meshes without indices
+	*/
 	void createArrayBuffer(const std::vector<float>& array);
-	unsigned int createElementArrayBuffer(const std::vector<unsigned int>& array);
 	/**
-	* \brief Sets the specified attribute of the vertex shaderProgram
+	* \brief Binds the shared buffers of the mesh to the bound VAO and points
+	* the attributes of the vertex shaderProgram at them. The vertices are
+	* interleaved, see PackedVertex, the indices take 16 bits if they fit.
 	*/
-	void setVertexShaderAttribute(
-		const char* attributeName,
-		const std::vector<float>& data,
-		int dataSize,
-		ShaderProgram& shaderProgram);
+	void createMesh(
+		const std::vector<float>& positions,
+		const std::vector<float>& colors,
+		const std::vector<float>& normals,
+		const std::vector<float>* uvs,
+		const std::vector<unsigned int>& indices);
 
 	unsigned int VAO = 0;
-	unsigned int VBO = 0;
+	const Mesh* mesh = nullptr;
 	unsigned int vertexCount = 0;
+	/**
+	* \brief Type of the indices of the mesh, for the draw calls
+	*/
+	GLenum indexType = GL_UNSIGNED_INT;
 	ShaderProgram& shaderProgram;
 };
 
@@ -1,4 +1,5 @@
 #include "scene_object_arrays.h"
+#include "gl_state.h"
 
 SceneObjectArrays::SceneObjectArrays(const std::vector<float>& positions, ShaderProgram& shaderProgram) 
 	: SceneObject(shaderProgram) {
@@ -11,7 +12,7 @@ SceneObjectArrays::SceneObjectArrays(const std::vector<float>& positions, Shader
 void SceneObjectArrays::createVertexArray(const std::vector<float>& positions) {
 	shaderProgram.use();
 	GLCall(glGenVertexArrays(1, &VAO));
-	GLCall(glBindVertexArray(VAO));
+	GLState::bindVertexArray(VAO);
 	createArrayBuffer(positions);
 	GLCall(glEnableVertexAttribArray(0));
 	GLCall(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0));
@@ -22,8 +23,7 @@ void SceneObjectArrays::draw(Scene& scene) {
 	shaderProgram.use();
 	setUniforms(scene);
 
-	GLCall(glBindVertexArray(VAO));
+	GLState::bindVertexArray(VAO);
 	GLCall(glDrawArrays(GL_TRIANGLES, 0, vertexCount));
-	GLCall(glBindVertexArray(0));
 }
 
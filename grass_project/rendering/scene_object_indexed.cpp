@@ -1,4 +1,5 @@
 #include "scene_object_indexed.h"
+#include "gl_state.h"
 
 
 SceneObjectIndexed::SceneObjectIndexed(
@@ -24,20 +25,10 @@ void SceneObjectIndexed::createVertexArray(
 	shaderProgram.use();
 	glGenVertexArrays(1, &VAO);
 	// Bind vertex array object
-	glBindVertexArray(VAO);
+	GLState::bindVertexArray(VAO);
 
-	// Set attributes
-	setVertexShaderAttribute("pos", positions, 3, shaderProgram);
-	setVertexShaderAttribute("color", colors, 4, shaderProgram);
-	setVertexShaderAttribute("normal", normals, 3, shaderProgram);
-	if (uvs != NULL) {
-		setVertexShaderAttribute("uvs", *uvs, 2, shaderProgram);
-	}
-	
-	// Create and bind the EBO
-	createElementArrayBuffer(indices);
-
-	vertexCount = (unsigned int)indices.size();
+	// Set attributes and bind the EBO
+	createMesh(positions, colors, normals, uvs, indices);
 }
 
 
@@ -45,6 +36,6 @@ void SceneObjectIndexed::draw(Scene& scene) {
 	shaderProgram.use();
 	setUniforms(scene);
 
-	GLCall(glBindVertexArray(VAO));
-	GLCall(glDrawElements(GL_TRIANGLES, vertexCount, GL_UNSIGNED_INT, 0));
+	GLState::bindVertexArray(VAO);
+	GLCall(glDrawElements(GL_TRIANGLES, vertexCount, indexType, 0));
 }
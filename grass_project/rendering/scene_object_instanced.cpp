@@ -1,4 +1,5 @@
 #include "scene_object_instanced.h"
+#include "gl_state.h"
 
 SceneObjectInstanced::SceneObjectInstanced(
 	const std::vector<float>& positions, 
@@ -22,11 +23,11 @@ void SceneObjectInstanced::createVertexArray(
 	shaderProgram.use();
 	GLCall(glGenVertexArrays(1, &VAO));
 	// Bind vertex array object
-	GLCall(glBindVertexArray(VAO));
+	GLState::bindVertexArray(VAO);
 
 	int instanceMatrixAttributeLocation = glGetAttribLocation(shaderProgram.getShaderProgramId(), "instanceMatrix");
 	GLCall(glEnableVertexAttribArray(instanceMatrixAttributeLocation));
-	GLCall(glBindBuffer(GL_ARRAY_BUFFER, instanceMatrixBuffer)); // this attribute comes from a different vertex buffer
+	GLState::bindBuffer(GL_ARRAY_BUFFER, instanceMatrixBuffer); // this attribute comes from a different vertex buffer
 	
 	// set attribute pointers for matrix (4 times vec4)
 	GLCall(glVertexAttribPointer(instanceMatrixAttributeLocation, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)0));
@@ -42,30 +43,20 @@ void SceneObjectInstanced::createVertexArray(
 	GLCall(glVertexAttribDivisor(instanceMatrixAttributeLocation + 2, 1));
 	GLCall(glVertexAttribDivisor(instanceMatrixAttributeLocation + 3, 1));
 
-	// Set attributes
-	setVertexShaderAttribute("pos", positions, 3, shaderProgram);
-	setVertexShaderAttribute("color", colors, 4, shaderProgram);
-	setVertexShaderAttribute("normal", normals, 3, shaderProgram);
-	if (uvs != NULL) {
-		setVertexShaderAttribute("uvs", *uvs, 2, shaderProgram);
-	}
+	// Set attributes and bind the EBO
+	createMesh(positions, colors, normals, uvs, indices);
 
-
-	// Create and bind the EBO
-	createElementArrayBuffer(indices);
-
-	vertexCount = (int)indices.size();
-
-	GLCall(glBindVertexArray(0))
+	GLState::bindVertexArray(0);
 }
 
 void SceneObjectInstanced::draw(Scene& scene) {
 	shaderProgram.use();
 	setUniforms(scene);
 
-	GLCall(glBindVertexArray(VAO));
-	GLCall(glDrawElementsInstanced(GL_TRIANGLES, vertexCount, GL_UNSIGNED_INT, NULL, scene.config.numBladesPerPatch));
-	GLCall(glBindVertexArray(0));
+	int instances = instanceCount < 0 ? scene.config.numBladesPerPatch : instanceCount;
+
+	GLState::bindVertexArray(VAO);
+	GLCall(glDrawElementsInstanced(GL_TRIANGLES, vertexCount, indexType, NULL, instances));
 }
 
 
@@ -40,6 +40,12 @@ public:
 		const std::vector<float>* uvs = NULL);
 
 	void draw(Scene& scene) override;
+
+	/**
+	* \brief Number of instances drawn. Negative draws one instance per blade
+	* of a patch.
+	*/
+	int instanceCount = -1;
 };
 
 #endif
\ No newline at end of file
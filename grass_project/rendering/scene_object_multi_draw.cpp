@@ -0,0 +1,190 @@
+#include "scene_object_multi_draw.h"
+#include "gl_state.h"
+
+#include <cstring>
+
+SceneObjectMultiDraw::SceneObjectMultiDraw(
+	const std::vector<float>& positions,
+	const std::vector<float>& colors,
+	const std::vector<unsigned int>& indices,
+	const std::vector<float>& normals,
+	ShaderProgram& shaderProgram,
+	const std::vector<float>* uvs,
+	unsigned int instanceBuffer,
+	const InstanceLayout* instanceLayout)
+	: SceneObject(shaderProgram) {
+	createVertexArray(positions, colors, indices, normals, uvs, instanceBuffer, instanceLayout);
+
+	GLCall(glGenBuffers(1, &drawModelBuffer));
+	GLCall(glGenBuffers(1, &drawParameterBuffer));
+	GLCall(glGenBuffers(1, &indirectBuffer));
+}
+
+SceneObjectMultiDraw::~SceneObjectMultiDraw() {
+	GLState::deleteBuffer(drawModelBuffer);
+	GLState::deleteBuffer(drawParameterBuffer);
+	GLState::deleteBuffer(indirectBuffer);
+}
+
+void SceneObjectMultiDraw::createVertexArray(
+	const std::vector<float>& positions,
+	const std::vector<float>& colors,
+	const std::vector<unsigned int>& indices,
+	const std::vector<float>& normals,
+	const std::vector<float>* uvs,
+	unsigned int instanceBuffer,
+	const InstanceLayout* instanceLayout) {
+	shaderProgram.use();
+	GLCall(glGenVertexArrays(1, &VAO));
+	GLState::bindVertexArray(VAO);
+
+	if (instanceBuffer != 0 && instanceLayout != nullptr) {
+		GLState::bindBuffer(GL_ARRAY_BUFFER, instanceBuffer); // these attributes come from a different vertex buffer
+		setVertexLayout(*instanceLayout, shaderProgram, 1, true);
+	}
+
+	// Set attributes and bind the EBO
+	createMesh(positions, colors, normals, uvs, indices);
+
+	GLState::bindVertexArray(0);
+}
+
+void SceneObjectMultiDraw::setDrawModels(const std::vector<glm::mat4>& models) {
+	maxDraws = (int)models.size();
+	if (maxDraws > drawModelCapacity) {
+		drawModelCapacity = maxDraws;
+		commandsDirty = true;
+	}
+	if (drawModelCapacity == 0)
+		return;
+
+	// Orphan the buffer, so the driver does not wait for the last frame's draw
+	GLState::bindBuffer(GL_SHADER_STORAGE_BUFFER, drawModelBuffer);
+	GLCall(glBufferData(GL_SHADER_STORAGE_BUFFER, drawModelCapacity * sizeof(glm::mat4), nullptr, GL_DYNAMIC_DRAW));
+	if (maxDraws > 0) {
+		GLCall(glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, maxDraws * sizeof(glm::mat4), models.data()));
+	}
+	GLState::bindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void SceneObjectMultiDraw::setDrawInstanceCounts(const std::vector<int>& instanceCounts) {
+	if (instanceCounts != drawInstanceCounts) {
+		drawInstanceCounts = instanceCounts;
+		commandsDirty = true;
+	}
+}
+
+void SceneObjectMultiDraw::setDrawParameters(const std::vector<glm::vec4>& parameters) {
+	int count = (int)parameters.size();
+	if (count > drawParameterCapacity) {
+		drawParameterCapacity = count;
+	}
+	if (drawParameterCapacity == 0)
+		return;
+
+	// Orphaned like the model matrices
+	GLState::bindBuffer(GL_SHADER_STORAGE_BUFFER, drawParameterBuffer);
+	GLCall(glBufferData(GL_SHADER_STORAGE_BUFFER, drawParameterCapacity * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW));
+	if (count > 0) {
+		GLCall(glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, count * sizeof(glm::vec4), parameters.data()));
+	}
+	GLState::bindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void SceneObjectMultiDraw::updateCommands(int instances) {
+	if (!commandsDirty && instances == commandInstances && maxDraws <= commandDraws)
+		return;
+
+	// Draws without a count of their own share instances, so there can be
+	// more commands than are drawn
+	DrawElementsIndirectCommand command = { vertexCount, (GLuint)instances, 0, 0, 0 };
+	std::vector<DrawElementsIndirectCommand> commands(drawModelCapacity, command);
+	size_t counted = glm::min(drawInstanceCounts.size(), commands.size());
+	for (size_t i = 0; i < counted; i++) {
+		commands[i].instanceCount = (GLuint)glm::max(drawInstanceCounts[i], 0);
+	}
+
+	// Orphaned, the counts can change every frame
+	GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+	GLCall(glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand),
+		commands.data(), GL_DYNAMIC_DRAW));
+	GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	commandInstances = instances;
+	commandDraws = drawModelCapacity;
+	commandsDirty = false;
+}
+
+void SceneObjectMultiDraw::draw(Scene& scene) {
+	int draws = drawCount < 0 ? maxDraws : glm::min(drawCount, maxDraws);
+	int instances = instanceCount < 0 ? scene.config.numBladesPerPatch : instanceCount;
+	if (draws == 0 || instances <= 0)
+		return;
+
+	shaderProgram.use();
+	setUniforms(scene);
+
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_MODEL_BUFFER_BINDING, drawModelBuffer);
+	if (drawParameterCapacity > 0)
+		GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_PARAMETER_BUFFER_BINDING, drawParameterBuffer);
+	GLState::bindVertexArray(VAO);
+	if (primitiveMode == GL_PATCHES)
+		GLCall(glPatchParameteri(GL_PATCH_VERTICES, (GLint)vertexCount));
+
+	if (commandBuffer != 0) {
+		if (!isDrawIdSupported())
+			GLCall(glUniform1i(shaderProgram.getUniformLocation("drawIndex"), 0));
+		GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+		GLCall(glDrawElementsIndirect(primitiveMode, indexType, nullptr));
+	}
+	else if (isDrawIdSupported()) {
+		updateCommands(instances);
+		GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+		GLCall(glMultiDrawElementsIndirect(primitiveMode, indexType, nullptr, draws, 0));
+	}
+	else {
+		GLint drawIndexLocation = shaderProgram.getUniformLocation("drawIndex");
+		for (int i = 0; i < draws; i++) {
+			int drawInstances = i < (int)drawInstanceCounts.size() ? drawInstanceCounts[i] : instances;
+			if (drawInstances <= 0)
+				continue;
+			GLCall(glUniform1i(drawIndexLocation, i));
+			GLCall(glDrawElementsInstanced(primitiveMode, vertexCount, indexType, NULL, drawInstances));
+		}
+	}
+}
+
+unsigned int SceneObjectMultiDraw::getDrawModelBuffer() const {
+	return drawModelBuffer;
+}
+
+unsigned int SceneObjectMultiDraw::getDrawParameterBuffer() const {
+	return drawParameterBuffer;
+}
+
+int SceneObjectMultiDraw::getMaxDraws() const {
+	return maxDraws;
+}
+
+unsigned int SceneObjectMultiDraw::getIndexCount() const {
+	return vertexCount;
+}
+
+bool SceneObjectMultiDraw::isDrawIdSupported() {
+	static int supported = -1;
+	if (supported < 0) {
+		supported = 0;
+		GLint extensionCount = 0;
+		GLCall(glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount));
+		for (GLint i = 0; i < extensionCount; i++) {
+			const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+			if (extension && std::strcmp(extension, "GL_ARB_shader_draw_parameters") == 0) {
+				supported = 1;
+				break;
+			}
+		}
+		if (!supported) {
+			LOG_WARNING("GL_ARB_shader_draw_parameters is not supported, drawing the patches one by one.");
+		}
+	}
+	return supported == 1;
+}
@@ -0,0 +1,198 @@
+/*
+ * The SceneObjectMultiDraw class draws the same mesh many times, each with
+ * its own model matrix, in a single multi draw indirect call.
+ */
+#ifndef SCENE_OBJECT_MULTI_DRAW_H
+#define SCENE_OBJECT_MULTI_DRAW_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <vector>
+#include "shader.h"
+#include "debug.h"
+#include "scene_object.h"
+#include "scene.h"
+
+/**
+ * \brief Binding point of the shader storage buffer with the model matrix of
+ * every draw, see draw_models.glsl
+ */
+const GLuint DRAW_MODEL_BUFFER_BINDING = 0;
+
+/**
+ * \brief Binding point of the shader storage buffer with the parameters of
+ * every draw, see draw_models.glsl
+ */
+const GLuint DRAW_PARAMETER_BUFFER_BINDING = 1;
+
+/**
+ * \brief Define that makes draw_models.glsl index the model matrices with
+ * gl_DrawIDARB, see SceneObjectMultiDraw::isDrawIdSupported
+ */
+const char* const MULTI_DRAW_ID_DEFINE = "MULTI_DRAW_ID";
+
+/**
+ * \brief Layout of a command in the indirect buffer, as
+ * glMultiDrawElementsIndirect reads it
+ */
+struct DrawElementsIndirectCommand {
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLuint baseVertex;
+	GLuint baseInstance;
+};
+
+/**
+ * \brief A per instance attribute of a SceneObjectMultiDraw
+ */
+using InstanceAttribute = VertexAttribute;
+
+/**
+ * \brief How the instance buffer of a SceneObjectMultiDraw is laid out
+ */
+using InstanceLayout = VertexLayout;
+
+/*
+ * Draws one mesh once per model matrix. The model matrices live in a shader
+ * storage buffer that the vertex shader indexes with the draw it belongs to,
+ * so all draws are submitted with one call and one set of uniforms. The
+ * shader has to include draw_models.glsl.
+ * Without ARB_shader_draw_parameters the draws are issued one by one, with
+ * the draw index in a uniform.
+ */
+class SceneObjectMultiDraw : public SceneObject {
+public:
+	/**
+	 * \param instanceBuffer Per instance data, or 0 if the mesh is not
+	 * instanced.
+	 * \param instanceLayout Attributes instanceBuffer holds.
+	 */
+	SceneObjectMultiDraw(
+		const std::vector<float>& positions,
+		const std::vector<float>& colors,
+		const std::vector<unsigned int>& indices,
+		const std::vector<float>& normals,
+		ShaderProgram& shaderProgram,
+		const std::vector<float>* uvs = NULL,
+		unsigned int instanceBuffer = 0,
+		const InstanceLayout* instanceLayout = nullptr);
+
+	~SceneObjectMultiDraw();
+
+	SceneObjectMultiDraw(const SceneObjectMultiDraw&) = delete;
+	SceneObjectMultiDraw& operator=(const SceneObjectMultiDraw&) = delete;
+
+	void createVertexArray(
+		const std::vector<float>& positions,
+		const std::vector<float>& colors,
+		const std::vector<unsigned int>& indices,
+		const std::vector<float>& normals,
+		const std::vector<float>* uvs,
+		unsigned int instanceBuffer,
+		const InstanceLayout* instanceLayout);
+
+	/**
+	 * \brief Uploads the model matrix of every draw, one draw per matrix.
+	 */
+	void setDrawModels(const std::vector<glm::mat4>& models);
+
+	/**
+	 * \brief Sets the number of instances of every draw, in the order of the
+	 * model matrices, instead of instanceCount for all of them. Empty goes
+	 * back to instanceCount.
+	 */
+	void setDrawInstanceCounts(const std::vector<int>& instanceCounts);
+
+	/**
+	 * \brief Uploads a vec4 per draw for the shader to interpret, in the order
+	 * of the model matrices.
+	 */
+	void setDrawParameters(const std::vector<glm::vec4>& parameters);
+
+	void draw(Scene& scene) override;
+
+	/**
+	 * \brief Whether gl_DrawIDARB is available, so shaders can be compiled
+	 * with MULTI_DRAW_ID_DEFINE. Checked once.
+	 */
+	static bool isDrawIdSupported();
+
+	/**
+	 * \brief Number of draws submitted, at most the number of model matrices.
+	 * Negative draws one per model matrix.
+	 */
+	int drawCount = -1;
+
+	/**
+	 * \brief Number of instances of every draw. Negative draws one instance
+	 * per blade of a patch.
+	 */
+	int instanceCount = 1;
+
+	/**
+	 * \brief What the indices are drawn as. GL_PATCHES draws every instance
+	 * as one patch of all the indices.
+	 */
+	GLenum primitiveMode = GL_TRIANGLES;
+
+	/**
+	 * \brief Indirect buffer holding a single command that is written on the
+	 * GPU, see BladeCuller. When set, that command is drawn with the first
+	 * model matrix instead of drawCount draws of instanceCount instances.
+	 */
+	unsigned int commandBuffer = 0;
+
+	/**
+	 * \brief Shader storage buffer with the model matrix of every draw
+	 */
+	unsigned int getDrawModelBuffer() const;
+
+	/**
+	 * \brief Shader storage buffer with the parameters of every draw
+	 */
+	unsigned int getDrawParameterBuffer() const;
+
+	/**
+	 * \brief Number of model matrices
+	 */
+	int getMaxDraws() const;
+
+	/**
+	 * \brief Number of indices of the mesh
+	 */
+	unsigned int getIndexCount() const;
+
+private:
+	/**
+	 * \brief Rewrites the indirect commands if the instance counts changed
+	 */
+	void updateCommands(int instances);
+
+	unsigned int drawModelBuffer = 0;
+	unsigned int drawParameterBuffer = 0;
+	unsigned int indirectBuffer = 0;
+	int maxDraws = 0;
+
+	/**
+	 * \brief See setDrawInstanceCounts
+	 */
+	std::vector<int> drawInstanceCounts;
+
+	/**
+	 * \brief Model matrices the buffer has room for
+	 */
+	int drawModelCapacity = 0;
+
+	int drawParameterCapacity = 0;
+
+	/**
+	 * \brief What the indirect buffer holds, commandDraws commands of
+	 * commandInstances instances, unless they come from drawInstanceCounts
+	 */
+	int commandDraws = 0;
+	int commandInstances = -1;
+	bool commandsDirty = true;
+};
+
+#endif
@@ -0,0 +1,116 @@
+#include "scene_uniform_buffer.h"
+#include "scene.h"
+#include "debug.h"
+#include "gl_state.h"
+#include "primitives.h"
+
+#include <cstddef>
+#include <cstring>
+
+// Offsets the std140 layout of the block gives these members
+static_assert(offsetof(SceneUniformData, lightColor) == 128, "SceneUniformData does not match std140");
+static_assert(offsetof(SceneUniformData, lightPos) == 144, "SceneUniformData does not match std140");
+static_assert(offsetof(SceneUniformData, ambientStrength) == 156, "SceneUniformData does not match std140");
+static_assert(offsetof(SceneUniformData, windDirection) == 160, "SceneUniformData does not match std140");
+static_assert(offsetof(SceneUniformData, lightIntensity) == 184, "SceneUniformData does not match std140");
+static_assert(offsetof(SceneUniformData, visualizeTexture) == 224, "SceneUniformData does not match std140");
+static_assert(offsetof(SceneUniformData, bladeTessellationDistance) == 232, "SceneUniformData does not match std140");
+static_assert(offsetof(SceneUniformData, bladeMeshWidth) == 240, "SceneUniformData does not match std140");
+static_assert(sizeof(SceneUniformData) == 256, "SceneUniformData does not match std140");
+
+SceneUniformBuffer::SceneUniformBuffer()
+{
+	GLint alignment = 256;
+	GLCall(glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment));
+	slotSize = ((GLsizeiptr)sizeof(SceneUniformData) + alignment - 1) / alignment * alignment;
+
+	GLCall(glGenBuffers(1, &buffer));
+	GLState::bindBuffer(GL_UNIFORM_BUFFER, buffer);
+	GLCall(glBufferData(GL_UNIFORM_BUFFER, slotSize * FRAMES_IN_FLIGHT, nullptr, GL_STREAM_DRAW));
+	GLState::bindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	// Bounds of the blade mesh, for the tessellated blades
+	glm::vec2 minXY(grassPositions[0], grassPositions[1]);
+	glm::vec2 maxXY = minXY;
+	for (size_t i = 0; i + 1 < grassPositions.size(); i += 3)
+	{
+		minXY = glm::min(minXY, glm::vec2(grassPositions[i], grassPositions[i + 1]));
+		maxXY = glm::max(maxXY, glm::vec2(grassPositions[i], grassPositions[i + 1]));
+	}
+	bladeMeshWidth = maxXY.x - minXY.x;
+	bladeMeshHeight = maxXY.y - minXY.y;
+}
+
+SceneUniformBuffer::~SceneUniformBuffer()
+{
+	for (GLsync fence : fences)
+	{
+		if (fence)
+			GLCall(glDeleteSync(fence));
+	}
+	GLState::deleteBuffer(buffer);
+}
+
+void SceneUniformBuffer::update(const Scene& scene)
+{
+	// The draws since the last update read the current slot
+	if (slot >= 0)
+	{
+		fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+	slot = (slot + 1) % FRAMES_IN_FLIGHT;
+
+	// Only waits if the GPU is more than FRAMES_IN_FLIGHT frames behind
+	if (fences[slot])
+	{
+		GLCall(glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED));
+		GLCall(glDeleteSync(fences[slot]));
+		fences[slot] = nullptr;
+	}
+
+	const Config& config = scene.config;
+	SceneUniformData data = {};
+	data.projection = scene.projection;
+	data.view = scene.view;
+	data.lightColor = config.lightColor;
+	data.lightPos = config.lightPosition;
+	data.ambientStrength = config.ambientStrength;
+	data.windDirection = config.windDirection;
+	// The wind textures repeat, so only the fraction matters. Keeps the
+	// texture coordinates precise however long the wind blows.
+	data.windOffset = glm::fract(config.windOffset);
+	data.velocityClampRange = config.fluidGridConfig.velocityClampRange;
+	data.lightIntensity = config.lightIntensity;
+	data.currentTime = config.currentTime;
+	data.windStrength = config.windStrength;
+	data.swayReach = config.swayReach;
+	data.velocityMultiplier = config.fluidGridConfig.velocityMultiplier;
+	data.worldMin = config.worldMin;
+	data.worldMax = config.worldMax;
+	data.patchSize = config.patchSize;
+	data.simulationMode = (int)config.simulationMode;
+	data.debugBlades = config.debugBlades;
+	data.visualizeTexture = config.visualizeTexture;
+	data.bladeTessellationLevel = config.tessellationConfig.maxLevel;
+	data.bladeTessellationDistance = config.tessellationConfig.fullDetailDistance;
+	data.bladeMeshHeight = bladeMeshHeight;
+	data.bladeMeshWidth = bladeMeshWidth;
+
+	// The fences already keep the GPU off this slot, the driver does not
+	// have to synchronize
+	GLState::bindBuffer(GL_UNIFORM_BUFFER, buffer);
+	void* mapped = glMapBufferRange(GL_UNIFORM_BUFFER, slot * slotSize, sizeof(SceneUniformData),
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (mapped)
+	{
+		std::memcpy(mapped, &data, sizeof(data));
+		GLCall(glUnmapBuffer(GL_UNIFORM_BUFFER));
+	}
+	else
+	{
+		LOG_ERROR("Could not map the scene uniform buffer");
+	}
+	GLState::bindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	GLState::bindBufferRange(GL_UNIFORM_BUFFER, SCENE_UNIFORM_BLOCK_BINDING, buffer, slot * slotSize, sizeof(SceneUniformData));
+}
@@ -0,0 +1,91 @@
+#ifndef SCENE_UNIFORM_BUFFER_H
+#define SCENE_UNIFORM_BUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+class Scene;
+
+/**
+ * \brief Binding point of the SceneUniforms block, see scene_uniforms.glsl
+ */
+const GLuint SCENE_UNIFORM_BLOCK_BINDING = 0;
+
+/**
+ * \brief The SceneUniforms block of scene_uniforms.glsl, in std140 layout.
+ * Every member is placed at its std140 offset without any padding, so the
+ * order of the members matters. std140 rounds the size of the block up to a
+ * whole vec4, which the trailing padding accounts for.
+ */
+struct SceneUniformData
+{
+	glm::mat4 projection;
+	glm::mat4 view;
+	glm::vec4 lightColor;
+	glm::vec3 lightPos;
+	float ambientStrength;
+	glm::vec2 windDirection;
+	glm::vec2 windOffset;
+	glm::vec2 velocityClampRange;
+	float lightIntensity;
+	float currentTime;
+	float windStrength;
+	float swayReach;
+	float velocityMultiplier;
+	float worldMin;
+	float worldMax;
+	float patchSize;
+	int simulationMode;
+	int debugBlades;
+	int visualizeTexture;
+	int bladeTessellationLevel;
+	float bladeTessellationDistance;
+	float bladeMeshHeight;
+	float bladeMeshWidth;
+	int padding[3];
+};
+
+/**
+ * \brief Uploads the scene wide uniforms once per frame into a uniform buffer
+ * every shader shares, instead of setting them for every draw.
+ * The buffer is a ring of one slot per frame in flight, so writing the next
+ * frame's slot never waits for the GPU to finish reading an older one.
+ */
+class SceneUniformBuffer
+{
+public:
+	SceneUniformBuffer();
+	~SceneUniformBuffer();
+
+	SceneUniformBuffer(const SceneUniformBuffer&) = delete;
+	SceneUniformBuffer& operator=(const SceneUniformBuffer&) = delete;
+
+	/**
+	 * \brief Writes the uniforms of scene into the next slot and binds it.
+	 * Call once per frame, before drawing.
+	 */
+	void update(const Scene& scene);
+
+private:
+	/**
+	 * \brief Frames the GPU may be behind before a slot has to be waited for
+	 */
+	static const int FRAMES_IN_FLIGHT = 3;
+
+	GLuint buffer = 0;
+	GLsizeiptr slotSize = 0;
+	int slot = -1;
+
+	/**
+	 * \brief Height and widest width of the blade mesh, see grassPositions
+	 */
+	float bladeMeshHeight = 0.0f;
+	float bladeMeshWidth = 0.0f;
+
+	/**
+	 * \brief Signalled when the GPU is done with the draws that read a slot
+	 */
+	GLsync fences[FRAMES_IN_FLIGHT] = {};
+};
+
+#endif
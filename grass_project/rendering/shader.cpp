@@ -1,9 +1,25 @@
 #include "shader.h"
 #include "debug.h"
 
-Shader::Shader(const char* path, GLenum type) {
+namespace
+{
+	bool readFile(const std::string& path, std::string& contents)
+	{
+		std::ifstream fileStream(path);
+		if (!fileStream)
+			return false;
+
+		std::stringstream codeStream;
+		codeStream << fileStream.rdbuf();
+		contents = codeStream.str();
+		return true;
+	}
+}
+
+Shader::Shader(const char* path, GLenum type, const std::vector<std::string>& defines) {
 	this->path = path;
 	this->type = type;
+	this->defines = defines;
 	id = glCreateShader(type);
 	if (compile()) {
 		initialized = true;
@@ -36,6 +52,24 @@ bool Shader::compile() {
 	catch (std::ifstream::failure e) {
 		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
 	}
+
+	if (!resolveIncludes(code)) {
+		return false;
+	}
+
+	if (!defines.empty()) {
+		// #version has to stay the first line
+		size_t versionEnd = code.find('\n', code.find("#version"));
+		if (versionEnd != std::string::npos) {
+			std::string defineLines;
+			for (const std::string& define : defines) {
+				defineLines += "#define " + define + "\n";
+			}
+			// Keep the line numbers of errors the same as in the file
+			defineLines += "#line 2\n";
+			code.insert(versionEnd + 1, defineLines);
+		}
+	}
 	const char* code_c = code.c_str();
 	
 	glShaderSource(id, 1, &code_c, NULL);
@@ -49,6 +83,40 @@ bool Shader::compile() {
 }
 
 
+bool Shader::resolveIncludes(std::string& code) {
+	std::string directory = path;
+	size_t slash = directory.find_last_of("/\\");
+	directory = slash == std::string::npos ? "" : directory.substr(0, slash + 1);
+
+	std::string resolved;
+	std::istringstream lines(code);
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(lines, line)) {
+		lineNumber++;
+
+		size_t directive = line.find("#include");
+		size_t open = line.find('"', directive);
+		size_t close = line.find('"', open + 1);
+		if (directive == std::string::npos || open == std::string::npos || close == std::string::npos) {
+			resolved += line + "\n";
+			continue;
+		}
+
+		std::string includePath = directory + line.substr(open + 1, close - open - 1);
+		std::string included;
+		if (!readFile(includePath, included)) {
+			std::cout << "ERROR::SHADER::INCLUDE_NOT_SUCCESFULLY_READ: " << includePath << std::endl;
+			return false;
+		}
+		resolved += included + "\n";
+		// Keep the line numbers of errors after the include the same as in the file
+		resolved += "#line " + std::to_string(lineNumber + 1) + "\n";
+	}
+	code = resolved;
+	return true;
+}
+
 bool Shader::isInitialized() {
 	return initialized;
 }
@@ -65,6 +133,10 @@ std::string Shader::shaderTypeToString() {
 		return "fragment";
 	case GL_COMPUTE_SHADER:
 		return "compute";
+	case GL_TESS_CONTROL_SHADER:
+		return "tessellation control";
+	case GL_TESS_EVALUATION_SHADER:
+		return "tessellation evaluation";
 	default:
 		return "unknown";
 	}
@@ -9,6 +9,7 @@
 #include <glm/glm.hpp>
 
 #include <string>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -23,8 +24,12 @@ public:
 	 * @brief Initialize and load a shader
 	 * @param shaderPath path to the shader
 	 * @param type The type of shader: Vertex/Fragment/Compute
+	 * @param defines Inserted as #define lines after the #version line, eg.
+	 * "OCTAVES 6"
+	 * Lines like #include "file.glsl" are replaced with that file, relative to
+	 * the directory of the shader.
 	*/
-	Shader(const char* shaderPath, GLenum type);
+	Shader(const char* shaderPath, GLenum type, const std::vector<std::string>& defines = {});
 
 	~Shader();
 
@@ -63,12 +68,23 @@ private:
 	*/
 	GLenum type = 0;
 
+	/**
+	 * @brief Defines inserted after the #version line
+	*/
+	std::vector<std::string> defines;
+
 	/**
 	 * @brief Helper function for getting a string representation of the shader type
 	 * @return The string representation of the shader type eg. "Vertex" 
 	*/
 	std::string shaderTypeToString();
 
+	/**
+	 * @brief Replaces the #include lines of code with the included files
+	 * @return Returns false if an included file could not be read
+	*/
+	bool resolveIncludes(std::string& code);
+
 	/**
 	 * \brief Utility function for checking shaderProgram compilation or linking errors. 
 	 * \param shaderProgram - Shader id 
@@ -1,5 +1,24 @@
 #include "shader_program.h"
+#include "scene_uniform_buffer.h"
 #include "debug.h"
+#include "gl_state.h"
+
+#include <cstring>
+
+namespace
+{
+	/**
+	 * @brief GLSL names of the scene uniforms, in the order of SceneUniform
+	 */
+	const char* SCENE_UNIFORM_NAMES[(int)SceneUniform::COUNT] = {
+		"model",
+		"objectColor",
+		"skybox",
+		"windX",
+		"windY",
+		"particleColor",
+	};
+}
 
 ShaderProgram::ShaderProgram(std::vector<Shader *> shaders, const std::string &name) : shaders(shaders), name(name) {
 	id = glCreateProgram();
@@ -23,6 +42,60 @@ void ShaderProgram::linkShaders()
 		GLCall(glDetachShader(id, shader->getShaderId()));
 	}
 	checkShaderProgramError();
+	resolveUniforms();
+}
+
+void ShaderProgram::resolveUniforms()
+{
+	uniforms.clear();
+	sceneUniforms.clear();
+	for (UniformShadow& shadow : shadows)
+	{
+		shadow.valid = false;
+	}
+
+	GLuint blockIndex = glGetUniformBlockIndex(id, "SceneUniforms");
+	if (blockIndex != GL_INVALID_INDEX)
+	{
+		GLCall(glUniformBlockBinding(id, blockIndex, SCENE_UNIFORM_BLOCK_BINDING));
+	}
+
+	GLint count = 0;
+	GLCall(glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count));
+
+	GLchar nameBuffer[128];
+	for (GLint i = 0; i < count; i++)
+	{
+		GLsizei length;
+		GLint size;
+		GLenum type;
+		GLCall(glGetActiveUniform(id, (GLuint)i, sizeof(nameBuffer), &length, &size, &type, nameBuffer));
+
+		std::string uniformName = nameBuffer;
+		GLint location = glGetUniformLocation(id, nameBuffer);
+		// Uniforms in blocks have no location
+		if (location == -1)
+			continue;
+
+		UniformInfo info = { location, SceneUniform::COUNT };
+		for (int u = 0; u < (int)SceneUniform::COUNT; u++)
+		{
+			if (uniformName == SCENE_UNIFORM_NAMES[u])
+			{
+				info.sceneUniform = (SceneUniform)u;
+				sceneUniforms.push_back({ info.sceneUniform, location });
+				break;
+			}
+		}
+		uniforms[uniformName] = info;
+
+		// Arrays are listed as name[0], but are set through name
+		size_t bracket = uniformName.find('[');
+		if (bracket != std::string::npos)
+		{
+			uniforms[uniformName.substr(0, bracket)] = info;
+		}
+	}
 }
 
 void ShaderProgram::use() const
@@ -31,7 +104,7 @@ void ShaderProgram::use() const
 		assert(shader->isInitialized());
 	}
 
-	glUseProgram(id);
+	GLState::useProgram(id);
 }
 
 void ShaderProgram::reloadShaders()
@@ -51,6 +124,13 @@ const std::string &ShaderProgram::getName() const
 
 GLint ShaderProgram::getUniformLocation(const std::string &name) const
 {
+	auto it = uniforms.find(name);
+	if (it != uniforms.end())
+	{
+		return it->second.location;
+	}
+
+	// Not active, or an element or member the table does not list
 	GLint location = glGetUniformLocation(id, name.c_str());
 	if (location == -1)
 	{
@@ -63,63 +143,139 @@ GLint ShaderProgram::getUniformLocation(const std::string &name) const
 	return location;
 }
 
+void ShaderProgram::invalidateUniform(const std::string &name) const
+{
+	auto it = uniforms.find(name);
+	if (it != uniforms.end() && it->second.sceneUniform != SceneUniform::COUNT)
+	{
+		shadows[(int)it->second.sceneUniform].valid = false;
+	}
+}
+
+GLint ShaderProgram::getUniformLocationForWrite(const std::string &name) const
+{
+	invalidateUniform(name);
+	return getUniformLocation(name);
+}
+
+const std::vector<SceneUniformBinding>& ShaderProgram::getSceneUniforms() const
+{
+	return sceneUniforms;
+}
+
+bool ShaderProgram::changeShadow(SceneUniform uniform, const void* value, size_t size)
+{
+	UniformShadow& shadow = shadows[(int)uniform];
+	if (shadow.valid && std::memcmp(shadow.value, value, size) == 0)
+		return false;
+
+	std::memcpy(shadow.value, value, size);
+	shadow.valid = true;
+	return true;
+}
+
+void ShaderProgram::setUniform(const SceneUniformBinding& binding, int value)
+{
+	if (changeShadow(binding.uniform, &value, sizeof(value)))
+		glUniform1i(binding.location, value);
+}
+
+void ShaderProgram::setUniform(const SceneUniformBinding& binding, float value)
+{
+	if (changeShadow(binding.uniform, &value, sizeof(value)))
+		glUniform1f(binding.location, value);
+}
+
+void ShaderProgram::setUniform(const SceneUniformBinding& binding, const glm::vec2& value)
+{
+	if (changeShadow(binding.uniform, &value[0], sizeof(value)))
+		glUniform2fv(binding.location, 1, &value[0]);
+}
+
+void ShaderProgram::setUniform(const SceneUniformBinding& binding, const glm::vec3& value)
+{
+	if (changeShadow(binding.uniform, &value[0], sizeof(value)))
+		glUniform3fv(binding.location, 1, &value[0]);
+}
+
+void ShaderProgram::setUniform(const SceneUniformBinding& binding, const glm::vec4& value)
+{
+	if (changeShadow(binding.uniform, &value[0], sizeof(value)))
+		glUniform4fv(binding.location, 1, &value[0]);
+}
+
+void ShaderProgram::setUniform(const SceneUniformBinding& binding, const glm::mat4& value)
+{
+	if (changeShadow(binding.uniform, &value[0][0], sizeof(value)))
+		glUniformMatrix4fv(binding.location, 1, GL_FALSE, &value[0][0]);
+}
+
 void ShaderProgram::setBool(const std::string &name, bool value) const
 {
-	glUniform1i(getUniformLocation(name), (int)value);
+	glUniform1i(getUniformLocationForWrite(name), (int)value);
 }
 
 void ShaderProgram::setInt(const std::string &name, int value) const
 {
-	glUniform1i(getUniformLocation(name), value);
+	glUniform1i(getUniformLocationForWrite(name), value);
+}
+
+void ShaderProgram::setUint(const std::string &name, unsigned int value) const
+{
+	glUniform1ui(getUniformLocationForWrite(name), value);
 }
 
 void ShaderProgram::setFloat(const std::string &name, float value) const
 {
-	GLCall(glUniform1f(getUniformLocation(name), value));
+	GLCall(glUniform1f(getUniformLocationForWrite(name), value));
 }
 
 void ShaderProgram::setVec2(const std::string &name, const glm::vec2 &value) const
 {
-	glUniform2fv(getUniformLocation(name), 1, &value[0]);
+	glUniform2fv(getUniformLocationForWrite(name), 1, &value[0]);
 }
 void ShaderProgram::setVec2(const std::string &name, float x, float y) const
 {
-	glUniform2f(getUniformLocation(name), x, y);
+	glUniform2f(getUniformLocationForWrite(name), x, y);
+}
+void ShaderProgram::setIVec2(const std::string &name, int x, int y) const
+{
+	glUniform2i(getUniformLocationForWrite(name), x, y);
 }
 
 void ShaderProgram::setVec3(const std::string &name, const glm::vec3 &value) const
 {
-	glUniform3fv(getUniformLocation(name), 1, &value[0]);
+	glUniform3fv(getUniformLocationForWrite(name), 1, &value[0]);
 }
 
 void ShaderProgram::setVec3(const std::string &name, float x, float y, float z) const
 {
-	glUniform3f(getUniformLocation(name), x, y, z);
+	glUniform3f(getUniformLocationForWrite(name), x, y, z);
 }
 
 void ShaderProgram::setVec4(const std::string &name, const glm::vec4 &value) const
 {
-	glUniform4fv(getUniformLocation(name), 1, &value[0]);
+	glUniform4fv(getUniformLocationForWrite(name), 1, &value[0]);
 }
 
 void ShaderProgram::setVec4(const std::string &name, float x, float y, float z, float w) const
 {
-	glUniform4f(getUniformLocation(name), x, y, z, w);
+	glUniform4f(getUniformLocationForWrite(name), x, y, z, w);
 }
 
 void ShaderProgram::setMat2(const std::string &name, const glm::mat2 &mat) const
 {
-	glUniformMatrix2fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
+	glUniformMatrix2fv(getUniformLocationForWrite(name), 1, GL_FALSE, &mat[0][0]);
 }
 
 void ShaderProgram::setMat3(const std::string &name, const glm::mat3 &mat) const
 {
-	glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
+	glUniformMatrix3fv(getUniformLocationForWrite(name), 1, GL_FALSE, &mat[0][0]);
 }
 
 void ShaderProgram::setMat4(const std::string &name, const glm::mat4 &mat) const
 {
-	glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
+	glUniformMatrix4fv(getUniformLocationForWrite(name), 1, GL_FALSE, &mat[0][0]);
 }
 
 
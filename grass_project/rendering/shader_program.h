@@ -5,6 +5,30 @@
 
 #include <vector>
 #include <string>
+#include <unordered_map>
+
+/**
+ * @brief Uniforms SceneObject sets per object, see SceneObject::setUniforms.
+ * Scene wide uniforms are in the SceneUniforms block, see
+ * SceneUniformBuffer.
+ */
+enum class SceneUniform {
+	MODEL,
+	OBJECT_COLOR,
+	SKYBOX,
+	WIND_X,
+	WIND_Y,
+	PARTICLE_COLOR,
+	COUNT
+};
+
+/**
+ * @brief A scene uniform the program uses, and where
+ */
+struct SceneUniformBinding {
+	SceneUniform uniform;
+	GLint location;
+};
 
 /**
  * @brief Represents a opengl shader program
@@ -32,13 +56,41 @@ public:
 	 */
 	const std::string& getName() const;
 
+	/**
+	 * @brief Location of a uniform, looked up in the table built when linking
+	 */
 	GLint getUniformLocation(const std::string& name) const;
 
+	/**
+	 * @brief Forgets the value setUniform last uploaded for a scene uniform.
+	 * Call before writing it with glUniform directly.
+	 */
+	void invalidateUniform(const std::string& name) const;
+
+	/**
+	 * @brief The scene uniforms that are active in the program, resolved
+	 * when linking.
+	 */
+	const std::vector<SceneUniformBinding>& getSceneUniforms() const;
+
+	/**
+	 * @brief Uploads a scene uniform, unless it already has that value. The
+	 * program has to be in use.
+	 */
+	void setUniform(const SceneUniformBinding& binding, int value);
+	void setUniform(const SceneUniformBinding& binding, float value);
+	void setUniform(const SceneUniformBinding& binding, const glm::vec2& value);
+	void setUniform(const SceneUniformBinding& binding, const glm::vec3& value);
+	void setUniform(const SceneUniformBinding& binding, const glm::vec4& value);
+	void setUniform(const SceneUniformBinding& binding, const glm::mat4& value);
+
 	void setBool(const std::string& name, bool value) const;
 	void setInt(const std::string& name, int value) const;
+	void setUint(const std::string& name, unsigned int value) const;
 	void setFloat(const std::string& name, float value) const;
 	void setVec2(const std::string& name, const glm::vec2& value) const;
 	void setVec2(const std::string& name, float x, float y) const;
+	void setIVec2(const std::string& name, int x, int y) const;
 	void setVec3(const std::string& name, const glm::vec3& value) const;
 	void setVec3(const std::string& name, float x, float y, float z) const;
 	void setVec4(const std::string& name, const glm::vec4& value) const;
@@ -55,6 +107,41 @@ private:
 	std::string name;
 
 	void checkShaderProgramError();
+
+	/**
+	 * @brief Location of a uniform the set functions are about to write,
+	 * see invalidateUniform
+	 */
+	GLint getUniformLocationForWrite(const std::string& name) const;
+
+	/**
+	 * @brief Builds the uniform tables from the active uniforms
+	 */
+	void resolveUniforms();
+
+	/**
+	 * @brief Whether the value uploaded for uniform differs from value, which
+	 * becomes the uploaded value.
+	 */
+	bool changeShadow(SceneUniform uniform, const void* value, size_t size);
+
+	struct UniformInfo {
+		GLint location;
+		// SceneUniform::COUNT if it is not a scene uniform
+		SceneUniform sceneUniform;
+	};
+
+	/**
+	 * @brief Copy of the last value uploaded for a scene uniform
+	 */
+	struct UniformShadow {
+		bool valid = false;
+		float value[16];
+	};
+
+	std::unordered_map<std::string, UniformInfo> uniforms;
+	std::vector<SceneUniformBinding> sceneUniforms;
+	mutable UniformShadow shadows[(int)SceneUniform::COUNT];
 };
 
 #endif // !H_SHADER_PROGRAM
@@ -1,6 +1,7 @@
 #include "texture.h"
 
 #include "imported_image.h"
+#include "gl_state.h"
 
 Texture::Texture(const std::string &label, GLuint textureType)
 	:textureType(textureType)
@@ -10,6 +11,11 @@ Texture::Texture(const std::string &label, GLuint textureType)
 	setLabel(label);
 }
 
+Texture::~Texture()
+{
+	GLState::deleteTexture(textureID);
+}
+
 void Texture::generateMipmap()
 {
 	GLCall(glGenerateMipmap(textureType));
@@ -30,18 +36,18 @@ void Texture::setFilter(GLuint filterType)
 
 void Texture::activate()
 {
-	GLCall(glActiveTexture(GL_TEXTURE0 + textureID));
+	GLState::activeTexture(textureID);
 }
 
 void Texture::bind()
 {
-	GLCall(glBindTexture(textureType, textureID));
+	GLState::bindTexture(textureType, textureID);
 }
 
 void Texture::unbind()
 {
 	activate();
-	GLCall(glBindTexture(textureType, 0));
+	GLState::bindTexture(textureType, 0);
 }
 
 
@@ -76,7 +82,8 @@ unsigned int Texture::loadTextureSingleChannel(int textureSize, void *data) {
 	// For single channel textures, ONLY the red channel is used!!! Don't bother changing the rest, you will get confused!
 	float borderColor[] = { 0.5f, 0, 0, 0 };
 	GLCall(glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor));  
-	GLCall(glTexImage2D(textureType, 0, GL_RED, textureSize, textureSize, 0, GL_RED, GL_FLOAT, data));
+	// Sized, so the texture can be bound as an r8 image for compute shaders
+	GLCall(glTexImage2D(textureType, 0, GL_R8, textureSize, textureSize, 0, GL_RED, GL_FLOAT, data));
 
 	return textureID;
 }
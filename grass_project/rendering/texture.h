@@ -21,6 +21,14 @@ public:
 	 */
 	explicit Texture(const std::string &label, GLuint textureType);
 
+	/**
+	 * \brief Deletes the OpenGL texture
+	 */
+	~Texture();
+
+	Texture(const Texture&) = delete;
+	Texture& operator=(const Texture&) = delete;
+
 	/**
 	 * \brief Activates the slot of this texture
 	 */
@@ -0,0 +1,80 @@
+#include "vertex_layout.h"
+#include "shader_program.h"
+#include "debug.h"
+#include "logger.h"
+
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+static_assert(sizeof(PackedVertex) == 24, "PackedVertex has padding");
+
+const VertexLayout PACKED_VERTEX_LAYOUT = {
+	{
+		{ "pos", 3, GL_FLOAT, GL_FALSE, offsetof(PackedVertex, position) },
+		{ "color", 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(PackedVertex, color) },
+		{ "normal", 4, GL_INT_2_10_10_10_REV, GL_TRUE, offsetof(PackedVertex, normal) },
+		{ "uvs", 2, GL_HALF_FLOAT, GL_FALSE, offsetof(PackedVertex, uvs) },
+	},
+	sizeof(PackedVertex)
+};
+
+std::vector<PackedVertex> packVertices(
+	const std::vector<float>& positions,
+	const std::vector<float>& colors,
+	const std::vector<float>& normals,
+	const std::vector<float>* uvs) {
+	size_t count = positions.size() / 3;
+	std::vector<PackedVertex> vertices(count);
+	for (size_t i = 0; i < count; i++) {
+		PackedVertex& vertex = vertices[i];
+		vertex.position[0] = positions[i * 3];
+		vertex.position[1] = positions[i * 3 + 1];
+		vertex.position[2] = positions[i * 3 + 2];
+
+		glm::vec4 color(0.0f);
+		if (colors.size() >= (i + 1) * 4)
+			color = { colors[i * 4], colors[i * 4 + 1], colors[i * 4 + 2], colors[i * 4 + 3] };
+		vertex.color = glm::packUnorm4x8(color);
+
+		glm::vec4 normal(0.0f);
+		if (normals.size() >= (i + 1) * 3)
+			normal = { normals[i * 3], normals[i * 3 + 1], normals[i * 3 + 2], 0.0f };
+		vertex.normal = glm::packSnorm3x10_1x2(normal);
+
+		glm::vec2 uv(0.0f);
+		if (uvs != nullptr && uvs->size() >= (i + 1) * 2)
+			uv = { (*uvs)[i * 2], (*uvs)[i * 2 + 1] };
+		vertex.uvs = glm::packHalf2x16(uv);
+	}
+	return vertices;
+}
+
+void setVertexLayout(const VertexLayout& layout, ShaderProgram& shaderProgram, GLuint divisor, bool required) {
+	for (const VertexAttribute& attribute : layout.attributes) {
+		int location = glGetAttribLocation(shaderProgram.getShaderProgramId(), attribute.name);
+		if (location < 0) {
+			if (required)
+				LOG_ERROR("Attribute %s is not used by the shader %s", attribute.name, shaderProgram.getName().c_str());
+			continue;
+		}
+		GLCall(glEnableVertexAttribArray(location));
+		GLCall(glVertexAttribPointer(location, attribute.size, attribute.type, attribute.normalized,
+			layout.stride, (void*)attribute.offset));
+		GLCall(glVertexAttribDivisor(location, divisor));
+	}
+}
+
+GLenum uploadIndices(const std::vector<unsigned int>& indices) {
+	unsigned int maxIndex = indices.empty() ? 0 : *std::max_element(indices.begin(), indices.end());
+	if (maxIndex <= UINT16_MAX) {
+		std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+		GLCall(glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(uint16_t), shortIndices.data(),
+			GL_STATIC_DRAW));
+		return GL_UNSIGNED_SHORT;
+	}
+	GLCall(glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(),
+		GL_STATIC_DRAW));
+	return GL_UNSIGNED_INT;
+}
@@ -0,0 +1,80 @@
+/*
+ * Describes how vertex attributes are laid out in a buffer, and packs the
+ * meshes of the SceneObjects into a single interleaved buffer.
+ */
+#ifndef VERTEX_LAYOUT_H
+#define VERTEX_LAYOUT_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+class ShaderProgram;
+
+/**
+ * \brief An attribute in a vertex or instance buffer, as
+ * glVertexAttribPointer takes it
+ */
+struct VertexAttribute {
+	const char* name;
+	GLint size;
+	GLenum type;
+	GLboolean normalized;
+	size_t offset;
+};
+
+/**
+ * \brief How the attributes of a buffer are interleaved
+ */
+struct VertexLayout {
+	std::vector<VertexAttribute> attributes;
+	GLsizei stride;
+};
+
+/**
+ * \brief A vertex of a mesh as the SceneObjects upload it, 24 bytes instead
+ * of the 48 of a float per component:
+ * position:	three floats
+ * color:		four normalized bytes
+ * normal:		normalized 10:10:10:2
+ * uvs:			two half floats
+ */
+struct PackedVertex {
+	float position[3];
+	glm::uint32 color;
+	glm::uint32 normal;
+	glm::uint32 uvs;
+};
+
+/**
+ * \brief The pos, color, normal and uvs attributes of a PackedVertex
+ */
+extern const VertexLayout PACKED_VERTEX_LAYOUT;
+
+/**
+ * \brief Interleaves the separate attribute streams of a mesh, three
+ * position, four color, three normal and two uv floats per vertex.
+ * Missing colors, normals or uvs are zero.
+ */
+std::vector<PackedVertex> packVertices(
+	const std::vector<float>& positions,
+	const std::vector<float>& colors,
+	const std::vector<float>& normals,
+	const std::vector<float>* uvs);
+
+/**
+ * \brief Points the attributes of layout that shaderProgram uses at the
+ * buffer bound to GL_ARRAY_BUFFER, in the bound vertex array.
+ * \param divisor 0 for per vertex attributes, 1 for per instance.
+ * \param required Logs an error for attributes the shader does not use.
+ */
+void setVertexLayout(const VertexLayout& layout, ShaderProgram& shaderProgram, GLuint divisor, bool required);
+
+/**
+ * \brief Uploads indices into the bound GL_ELEMENT_ARRAY_BUFFER, as 16-bit
+ * indices if they all fit.
+ * \return The type to draw them with, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.
+ */
+GLenum uploadIndices(const std::vector<unsigned int>& indices);
+
+#endif
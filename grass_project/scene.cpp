@@ -1,5 +1,8 @@
 #include "scene.h"
 #include "rendering/glmutils.h"
+#include "rendering/scene_object_multi_draw.h"
+#include "rendering/gl_state.h"
+#include "grass_simulation/patch_field.h"
 #include <glm\glm.hpp>
 #include "grass_simulation/grass_math.h"
 
@@ -42,26 +45,47 @@ void Scene::updateDynamic() {
 void Scene::render() {
 	GLCall(glDepthFunc(GL_LEQUAL)); // Why do we have this?
 
+	if (uniformBuffer)
+		uniformBuffer->update(*this);
+
 	for (auto object : sceneObjects) {
 		if (object->isVisible)
 			object->draw(*this);
 	}
 
-	glEnable(GL_CULL_FACE);
-	for (int i = 0; i < config.numPatches; i++) {
-		patches[i]->draw(*this);
+	bool tessellated = config.tessellationConfig.enabled;
+	SceneObjectMultiDraw* drawnBlades = tessellated && tessellatedBlades ? tessellatedBlades : blades;
+	if (config.proceduralBlades && proceduralBlades)
+		drawnBlades = tessellated && proceduralTessellatedBlades ? proceduralTessellatedBlades : proceduralBlades;
+
+	if (patchField && patches && drawnBlades)
+		patchField->cull(*this, *patches, *drawnBlades, impostorCards ? &impostorCards->getCards() : nullptr);
+
+	if (patches) {
+		GLState::enable(GL_CULL_FACE);
+		patches->draw(*this);
+		GLState::disable(GL_CULL_FACE);
 	}
-	glDisable(GL_CULL_FACE);
 
-	for (int i = 0; i < config.numPatches; i++) {
-		blades[i]->draw(*this);
+	if (drawnBlades) {
+		// The density map is applied by the culling pass too
+		if (bladeCuller && (config.cullingConfig.enabled || config.densityMapConfig.enabled)) {
+			bladeCuller->cull(*this, *drawnBlades);
+			bladeCuller->draw(*this);
+		}
+		else {
+			drawnBlades->draw(*this);
+		}
 	}
 
+	if (impostorCards && config.impostorConfig.enabled)
+		impostorCards->draw(*this);
+
 	if (config.fluidGridConfig.shouldDrawFans)
 	{
 		glm::vec4 oldColor = config.lightColor;
 
-		glEnable(GL_BLEND);
+		GLState::enable(GL_BLEND);
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 		for (size_t fanIndex = 0; fanIndex < config.fluidGridConfig.fans.size(); fanIndex++)
@@ -74,7 +98,7 @@ void Scene::render() {
 			fanDebugIcon->draw(*this);
 		}
 
-		glDisable(GL_BLEND);
+		GLState::disable(GL_BLEND);
 
 		config.lightColor = oldColor;
 	}
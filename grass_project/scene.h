@@ -4,9 +4,16 @@
 #include <vector>
 #include "rendering/scene_object.h"
 #include "rendering/shader.h"
+#include "rendering/scene_uniform_buffer.h"
 #include "grass_simulation/perlin_noise.h"
 #include "grass_simulation/fluid_grid.h"
 #include "grass_simulation/grass_math.h"
+#include "grass_simulation/particle_system.h"
+#include "grass_simulation/blade_culler.h"
+#include "grass_simulation/patch_field.h"
+#include "grass_simulation/impostor_cards.h"
+
+class SceneObjectMultiDraw;
 
 /**
 * \brief Sets the appearance of the skybox
@@ -32,10 +39,29 @@ enum class BladeDistribution {
 	ONE_DIRECTION
 };
 
+/**
+* Represents where the wind comes from
+*
+* FLUID_FLIPBOOK:	Plays back fluid grid wind that was baked to a file,
+*					instead of simulating it.
+*/
 enum class SimulationMode {
 	PERLIN_NOISE,
 	CHECKER_PATTERN,
-	FLUID_GRID
+	FLUID_GRID,
+	FLUID_FLIPBOOK
+};
+
+/**
+* Settings of the tessellated blades, drawn from one control point each.
+* maxLevel:				Segments of the blades up close.
+* fullDetailDistance:	Blades closer than this get all the segments, further
+*						ones fewer, down to a single triangle.
+*/
+struct TessellationConfig {
+	bool  enabled = false;
+	int   maxLevel = 8;
+	float fullDetailDistance = 10.0f;
 };
 
 /**
@@ -52,9 +78,17 @@ struct Config {
 	float bladeHeight = 5;
 	glm::vec2 windDirection = glm::normalize(glm::vec2(0.5f, 0.0f));
 	float windStrength = 0.0f;//0.05f;
+	// How far the wind has moved the wind textures, in texture widths
+	glm::vec2 windOffset = { 0.0f, 0.0f };
 
 	PerlinConfig perlinConfig;
 	FluidGridConfig fluidGridConfig;
+	ParticleConfig particleConfig;
+	CullingConfig cullingConfig;
+	DensityLodConfig densityLodConfig;
+	DensityMapConfig densityMapConfig;
+	ImpostorConfig impostorConfig;
+	TessellationConfig tessellationConfig;
 
 	int checkerSize = 32;
 	Texture* checkerPatternTexture = nullptr;
@@ -69,6 +103,9 @@ struct Config {
 	float lightIntensity = 10;
 
 	BladeDistribution bladeDistribution = BladeDistribution::HARRY_STYLES_WITH_RANDOS;
+	// Places the blades in the shaders from a hash of their patch and index
+	// instead of reading them from the instance buffer, see blade_instance.glsl
+	bool proceduralBlades = false;
 
 	bool visualizeTexture = false;
 	bool debugBlades = false;
@@ -91,8 +128,42 @@ public:
 	void render();
 
 	std::vector<SceneObject*> sceneObjects;
-	std::vector<SceneObject*> patches;
-	std::vector<SceneObject*> blades;
+	/**
+	* \brief Every patch, and the blades on every patch, each drawn with a
+	* single multi draw
+	*/
+	SceneObjectMultiDraw* patches = nullptr;
+	SceneObjectMultiDraw* blades = nullptr;
+
+	/**
+	* \brief The blades as one tessellated control point each, drawn instead
+	* of blades if enabled in the config
+	*/
+	SceneObjectMultiDraw* tessellatedBlades = nullptr;
+
+	/**
+	* \brief blades and tessellatedBlades without the instance buffer, drawn
+	* instead of them if the config places the blades procedurally
+	*/
+	SceneObjectMultiDraw* proceduralBlades = nullptr;
+	SceneObjectMultiDraw* proceduralTessellatedBlades = nullptr;
+
+	/**
+	* \brief Finds the visible patches, and hands them to patches and blades
+	*/
+	PatchField* patchField = nullptr;
+
+	/**
+	* \brief Culls the blades on the GPU before drawing them, if enabled in
+	* the config
+	*/
+	BladeCuller* bladeCuller = nullptr;
+
+	/**
+	* \brief Draws the patches too far away for blades, if enabled in the
+	* config
+	*/
+	ImpostorCards* impostorCards = nullptr;
 
 	Texture* currentSkyboxTexture = nullptr;
 	Texture* cubemapTextureDay = nullptr;
@@ -105,6 +176,11 @@ public:
 
 	ShaderProgram* lightShaderProgram;
 
+	/**
+	* \brief Scene wide uniforms of every shader, written at the start of render
+	*/
+	SceneUniformBuffer* uniformBuffer = nullptr;
+
 	/**
 	* \brief All variables that can be configured using the GUI
 	*/
@@ -120,6 +196,17 @@ public:
 		};
 	}
 
+	/**
+	* Samples the fluid grid wind at world space x/z positions, see
+	* FluidGrid::sampleVelocities.
+	*/
+	inline void sampleWindVelocities(const float* worldX, const float* worldZ, size_t count,
+		float* velocityX, float* velocityY)
+	{
+		config.fluidGridConfig.fluidGrid->sampleVelocities(worldX, worldZ, count,
+			config.worldMin, config.worldMax, velocityX, velocityY);
+	}
+
 	inline glm::vec2 mapPositionToWorldSpace(glm::vec2 pos)
 	{
 		return map(pos, 0.0, 1.0f, config.worldMin, config.worldMax);
@@ -0,0 +1,104 @@
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(unsigned int workerCount)
+{
+	if (workerCount == 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	}
+
+	workers.reserve(workerCount);
+	for (unsigned int i = 0; i < workerCount; i++)
+	{
+		workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wakeCondition.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& function)
+{
+	if (count == 0)
+		return;
+
+	grainSize = grainSize > 0 ? grainSize : 1;
+	size_t chunkCount = (count + grainSize - 1) / grainSize;
+
+	// Not worth waking anyone up for
+	if (workers.empty() || chunkCount == 1)
+	{
+		function(0, count);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job = &function;
+		jobCount = count;
+		jobGrainSize = grainSize;
+		jobChunkCount = chunkCount;
+		nextChunk.store(0, std::memory_order_relaxed);
+		busyWorkers = (unsigned int)workers.size();
+		generation++;
+	}
+	wakeCondition.notify_all();
+
+	runChunks();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	doneCondition.wait(lock, [this] { return busyWorkers == 0; });
+	job = nullptr;
+}
+
+unsigned int ThreadPool::getThreadCount() const
+{
+	return (unsigned int)workers.size() + 1;
+}
+
+void ThreadPool::workerLoop()
+{
+	uint64_t seenGeneration = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeCondition.wait(lock, [&] { return stopping || generation != seenGeneration; });
+			if (stopping)
+				return;
+			seenGeneration = generation;
+		}
+
+		runChunks();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--busyWorkers == 0)
+		{
+			doneCondition.notify_one();
+		}
+	}
+}
+
+void ThreadPool::runChunks()
+{
+	size_t chunk;
+	while ((chunk = nextChunk.fetch_add(1, std::memory_order_relaxed)) < jobChunkCount)
+	{
+		size_t begin = chunk * jobGrainSize;
+		size_t end = begin + jobGrainSize < jobCount ? begin + jobGrainSize : jobCount;
+		(*job)(begin, end);
+	}
+}
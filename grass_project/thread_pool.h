@@ -0,0 +1,70 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * \brief A fixed set of worker threads that split loops between them.
+ * The calling thread works along, so a pool without workers simply runs the
+ * loop on the calling thread.
+ */
+class ThreadPool
+{
+public:
+	/**
+	 * \brief Starts the worker threads.
+	 * \param workerCount Number of worker threads. Zero uses one worker less
+	 * than there are hardware threads, leaving one for the calling thread.
+	 */
+	explicit ThreadPool(unsigned int workerCount = 0);
+
+	/**
+	 * \brief Stops and joins the worker threads.
+	 */
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/**
+	 * \brief Splits [0, count) into chunks of grainSize and calls function for each
+	 * chunk on any of the threads. Returns when all chunks are done. Must not
+	 * be called from inside function.
+	 * \param function Called with the begin and end of a chunk.
+	 */
+	void parallelFor(size_t count, size_t grainSize, const std::function<void(size_t begin, size_t end)>& function);
+
+	/**
+	 * \brief Number of threads a loop is split between, including the calling
+	 * thread.
+	 */
+	unsigned int getThreadCount() const;
+
+private:
+	void workerLoop();
+	void runChunks();
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wakeCondition;
+	std::condition_variable doneCondition;
+
+	const std::function<void(size_t, size_t)>* job = nullptr;
+	size_t jobCount = 0;
+	size_t jobGrainSize = 1;
+	size_t jobChunkCount = 0;
+	std::atomic<size_t> nextChunk{ 0 };
+
+	uint64_t generation = 0;
+	unsigned int busyWorkers = 0;
+	bool stopping = false;
+};
+
+#endif
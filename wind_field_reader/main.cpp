@@ -0,0 +1,234 @@
+/* Example consumer of the wind field published by grass_project.
+ *
+ * Enable "Publish Wind Field" in the Fluid Grid window, then run this. It
+ * maps the shared memory read-only and prints a few statistics of the newest
+ * frame, reading the fields in place without copying them.
+ *
+ * Usage: wind_field_reader [number of reports]
+*/
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "grass_simulation/wind_field_layout.h"
+
+#ifdef _WIN32
+#define NOGDI
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * \brief Read-only view of the published shared memory
+ */
+struct SharedWindField
+{
+	const unsigned char* memory = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	HANDLE mapping = nullptr;
+#endif
+
+	const WindFieldSharedHeader* header() const
+	{
+		return (const WindFieldSharedHeader*)memory;
+	}
+};
+
+bool openWindField(SharedWindField& field)
+{
+#ifdef _WIN32
+	HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, WIND_FIELD_SHARED_MEMORY_NAME);
+	if (!mapping)
+		return false;
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!view)
+	{
+		CloseHandle(mapping);
+		return false;
+	}
+
+	MEMORY_BASIC_INFORMATION info;
+	VirtualQuery(view, &info, sizeof(info));
+	field.mapping = mapping;
+	field.memory = (const unsigned char*)view;
+	field.size = info.RegionSize;
+#else
+	int file = shm_open(WIND_FIELD_SHARED_MEMORY_NAME, O_RDONLY, 0);
+	if (file < 0)
+		return false;
+
+	struct stat fileStat;
+	if (fstat(file, &fileStat) != 0 || fileStat.st_size == 0)
+	{
+		close(file);
+		return false;
+	}
+
+	void* view = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_SHARED, file, 0);
+	close(file);
+	if (view == MAP_FAILED)
+		return false;
+
+	field.memory = (const unsigned char*)view;
+	field.size = (size_t)fileStat.st_size;
+#endif
+
+	const WindFieldSharedHeader* header = field.header();
+	if (field.size < sizeof(WindFieldSharedHeader) || header->magic != WIND_FIELD_MAGIC ||
+		header->version != WIND_FIELD_VERSION || header->slotCount != WIND_FIELD_RING_SLOTS ||
+		header->slotOffset != windFieldSlotOffset() || header->slotStride != windFieldSlotStride(header->resolution) ||
+		field.size < windFieldSharedMemorySize(header->resolution))
+	{
+		printf("Shared memory '%s' is not a version %u wind field\n", WIND_FIELD_SHARED_MEMORY_NAME, WIND_FIELD_VERSION);
+		return false;
+	}
+
+	return true;
+}
+
+void closeWindField(SharedWindField& field)
+{
+	if (!field.memory)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(field.memory);
+	CloseHandle(field.mapping);
+#else
+	munmap((void*)field.memory, field.size);
+#endif
+	field = {};
+}
+
+/**
+ * \brief Statistics of a frame, computed straight from shared memory
+ */
+struct WindFieldReport
+{
+	uint64_t frameId;
+	uint64_t timestampNanoseconds;
+	uint32_t resolution;
+	float centerVelX;
+	float centerVelY;
+	float meanSpeed;
+	float maxSpeed;
+	float totalDensity;
+};
+
+/**
+ * \brief Reads the newest frame under its seqlock.
+ * \return False if there is no frame yet.
+ */
+bool readLatestFrame(const SharedWindField& field, WindFieldReport& report)
+{
+	const WindFieldSharedHeader* header = field.header();
+
+	while (true)
+	{
+		uint64_t frameId = header->latestFrameId.load(std::memory_order_acquire);
+		if (frameId == 0)
+			return false;
+
+		// Checked when opening, but the publisher may have set up the memory
+		// again since, see closed
+		uint32_t headerResolution = header->resolution;
+		if (windFieldSharedMemorySize(headerResolution) > field.size)
+			return false;
+
+		const WindFieldSlotHeader* slot = (const WindFieldSlotHeader*)(field.memory + windFieldSlotOffset() +
+			(frameId % WIND_FIELD_RING_SLOTS) * windFieldSlotStride(headerResolution));
+
+		uint32_t sequenceBefore = slot->sequence.load(std::memory_order_acquire);
+		if (sequenceBefore & 1)
+			continue;
+
+		// The slot may be torn, only touch the fields if they fit the slot
+		uint32_t resolution = slot->resolution;
+		if (resolution != headerResolution)
+			continue;
+		size_t fieldSize = (size_t)resolution * resolution;
+		const float* density = (const float*)(slot + 1);
+		const float* velX = density + fieldSize;
+		const float* velY = velX + fieldSize;
+
+		report.frameId = slot->frameId;
+		report.timestampNanoseconds = slot->timestampNanoseconds;
+		report.resolution = resolution;
+
+		size_t center = (resolution / 2) * resolution + resolution / 2;
+		report.centerVelX = velX[center];
+		report.centerVelY = velY[center];
+
+		float speedSum = 0.0f;
+		report.maxSpeed = 0.0f;
+		report.totalDensity = 0.0f;
+		for (size_t i = 0; i < fieldSize; i++)
+		{
+			float speed = std::sqrt(velX[i] * velX[i] + velY[i] * velY[i]);
+			speedSum += speed;
+			report.maxSpeed = speed > report.maxSpeed ? speed : report.maxSpeed;
+			report.totalDensity += density[i];
+		}
+		report.meanSpeed = fieldSize ? speedSum / fieldSize : 0.0f;
+
+		// The frame is only valid if the publisher did not touch the slot meanwhile
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint32_t sequenceAfter = slot->sequence.load(std::memory_order_relaxed);
+		if (sequenceBefore == sequenceAfter)
+			return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int reports = argc > 1 ? atoi(argv[1]) : -1;
+
+	SharedWindField field;
+	uint64_t lastFrameId = 0;
+
+	for (int reported = 0; reports < 0 || reported < reports;)
+	{
+		if (!field.memory && !openWindField(field))
+		{
+			closeWindField(field);
+			printf("Waiting for the wind field publisher...\n");
+			std::this_thread::sleep_for(std::chrono::seconds(1));
+			continue;
+		}
+
+		// The publisher went away or changed resolution
+		if (field.header()->closed.load(std::memory_order_acquire))
+		{
+			closeWindField(field);
+			lastFrameId = 0;
+			continue;
+		}
+
+		WindFieldReport report;
+		if (readLatestFrame(field, report) && report.frameId != lastFrameId)
+		{
+			printf("Frame %llu (%ux%u, skipped %llu) t=%.3fs  center=(%.4f, %.4f)  mean speed=%.4f  max speed=%.4f  density=%.1f\n",
+				(unsigned long long)report.frameId, report.resolution, report.resolution,
+				(unsigned long long)(lastFrameId ? report.frameId - lastFrameId - 1 : 0),
+				report.timestampNanoseconds / 1e9,
+				report.centerVelX, report.centerVelY, report.meanSpeed, report.maxSpeed, report.totalDensity);
+			lastFrameId = report.frameId;
+			reported++;
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
+
+	closeWindField(field);
+	return 0;
+}